@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#include "Benchmark.h"
+
+#include "ofMain.h"
+#include "ofxEditor.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// count every heap allocation, the array & nothrow versions call these
+static std::atomic<size_t> s_allocs(0);
+
+//--------------------------------------------------------------
+void* operator new(std::size_t size) {
+	s_allocs++;
+	void *p = std::malloc(size == 0 ? 1 : size);
+	if(!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+//--------------------------------------------------------------
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+//--------------------------------------------------------------
+void operator delete(void *p, std::size_t size) noexcept {
+	std::free(p);
+}
+
+//--------------------------------------------------------------
+void Benchmark::begin(const std::string &name) {
+	m_current = Result();
+	m_current.name = name;
+	ofLogNotice("Benchmark") << "running " << name << "...";
+	m_draws = getNumDraws();
+	m_allocs = getNumAllocations();
+	m_start = std::chrono::steady_clock::now();
+}
+
+//--------------------------------------------------------------
+void Benchmark::end(size_t ops, const std::string &unit) {
+	std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+	m_current.allocs = getNumAllocations() - m_allocs;
+	m_current.draws = getNumDraws() - m_draws;
+	m_current.ns = std::chrono::duration<double, std::nano>(stop - m_start).count();
+	m_current.ops = ops;
+	m_current.unit = unit;
+	m_results.push_back(m_current);
+}
+
+//--------------------------------------------------------------
+void Benchmark::print() {
+	char line[256];
+	snprintf(line, sizeof(line), "%-16s %10s %-6s %14s %12s %12s %10s",
+		"workload", "ops", "unit", "ns/op", "allocs/op", "draws/op", "total ms");
+	ofLogNotice("Benchmark") << line;
+	for(size_t i = 0; i < m_results.size(); ++i) {
+		Result &r = m_results[i];
+		double ops = (r.ops > 0 ? r.ops : 1);
+		snprintf(line, sizeof(line), "%-16s %10zu %-6s %14.1f %12.2f %12.2f %10.1f",
+			r.name.c_str(), r.ops, r.unit.c_str(), r.ns / ops,
+			r.allocs / ops, r.draws / ops, r.ns / 1000000.0);
+		ofLogNotice("Benchmark") << line;
+	}
+}
+
+//--------------------------------------------------------------
+size_t Benchmark::getNumAllocations() {
+	return s_allocs;
+}
+
+// PROTECTED
+
+//--------------------------------------------------------------
+size_t Benchmark::getNumDraws() {
+	size_t draws = 0, vertices = 0;
+	if(ofxEditor::getFont()) {
+		ofxEditor::getFont()->getDrawStats(draws, vertices);
+	}
+	return draws;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+/// times a workload & counts the heap allocations made while running it,
+/// global operator new is replaced in Benchmark.cpp to count allocations
+class Benchmark {
+
+	public:
+
+		/// workload result
+		struct Result {
+			std::string name;  //< workload name
+			std::string unit;  //< what a single op is, ie. "char" or "frame"
+			size_t ops;        //< number of ops
+			double ns;         //< total time in nanoseconds
+			size_t allocs;     //< total heap allocations
+			size_t draws;      //< total font draw calls, headless only
+		};
+
+		/// start timing a workload
+		void begin(const std::string &name);
+
+		/// stop timing the current workload & save the result for a given
+		/// number of ops
+		void end(size_t ops, const std::string &unit);
+
+		/// print the results as a table
+		void print();
+
+		/// get the number of heap allocations so far
+		static size_t getNumAllocations();
+
+	protected:
+
+		std::vector<Result> m_results; //< finished workloads
+		Result m_current;              //< current workload
+		size_t m_allocs; //< allocations when the current workload began
+		size_t m_draws;  //< font draw calls when the current workload began
+		std::chrono::steady_clock::time_point m_start; //< current start time
+
+		/// get the number of font draw calls so far
+		static size_t getNumDraws();
+};
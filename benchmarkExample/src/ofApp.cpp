@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#include "ofApp.h"
+
+#define NUM_LINES      100000
+#define NUM_TYPED      10000
+#define NUM_PASTES     200
+#define PASTE_LINES    20
+#define NUM_UNDOS      1000
+#define NUM_REPL       10000
+
+#define WIDTH  1024
+#define HEIGHT 768
+
+//--------------------------------------------------------------
+void ofApp::setup() {
+
+	// headless font, glyphs are rendered into memory & draw calls are counted
+	if(!ofxEditor::loadFont("fonts/PrintChar21.ttf", 24, true)) {
+		ofExit(1);
+		return;
+	}
+	ofSeedRandom(1); // same workloads for each run
+
+	luaSyntax.setLang("Lua");
+	luaSyntax.addFileExt("lua");
+	luaSyntax.setSingleLineComment("--");
+	luaSyntax.setMultiLineComment("--[[", "]]");
+	luaSyntax.setStringLiteral("[[", "]]");
+	luaSyntax.setWord("function", ofxEditorSyntax::KEYWORD);
+	luaSyntax.setWord("local", ofxEditorSyntax::KEYWORD);
+	luaSyntax.setWord("if", ofxEditorSyntax::KEYWORD);
+	luaSyntax.setWord("then", ofxEditorSyntax::KEYWORD);
+	luaSyntax.setWord("return", ofxEditorSyntax::KEYWORD);
+	luaSyntax.setWord("end", ofxEditorSyntax::KEYWORD);
+	luaSyntax.setWord("print", ofxEditorSyntax::FUNCTION);
+	editor.getSettings().addSyntax(&luaSyntax);
+
+	colorScheme.setStringColor(ofColor::yellow);
+	colorScheme.setNumberColor(ofColor::orangeRed);
+	colorScheme.setCommentColor(ofColor::gray);
+	colorScheme.setKeywordColor(ofColor::fuchsia);
+	colorScheme.setTypenameColor(ofColor::red);
+	colorScheme.setFunctionColor(ofColor::green);
+	editor.setColorScheme(&colorScheme);
+	editor.setLineNumbers(true);
+	editor.resize(WIDTH, HEIGHT);
+
+	// workloads build on each other, starting with the opened file
+	benchOpen();
+	benchTyping();
+	benchPaste();
+	benchUndo();
+	benchScroll();
+	benchRepl();
+
+	benchmark.print();
+}
+
+//--------------------------------------------------------------
+void ofApp::update() {
+	ofExit(); // done
+}
+
+//--------------------------------------------------------------
+void ofApp::benchOpen() {
+	std::string path = ofToDataPath("bench.lua");
+	ofBuffer buffer;
+	buffer.set(generateText(NUM_LINES));
+	ofBufferToFile(path, buffer);
+
+	benchmark.begin("open");
+	editor.openFile("bench.lua");
+	editor.draw();
+	benchmark.end(editor.getNumLines(), "line");
+
+	ofFile::removeFile(path);
+}
+
+//--------------------------------------------------------------
+void ofApp::benchTyping() {
+	const std::string typed = "\tlocal x = foo(1, \"two\") -- three\n";
+	editor.setCurrentLine(editor.getNumLines()/2);
+	editor.draw();
+
+	benchmark.begin("typing");
+	for(int i = 0; i < NUM_TYPED; ++i) {
+		char c = typed[i % typed.size()];
+		editor.keyPressed(c == '\n' ? OF_KEY_RETURN : c);
+		editor.draw();
+	}
+	benchmark.end(NUM_TYPED, "char");
+}
+
+//--------------------------------------------------------------
+void ofApp::benchPaste() {
+	std::string block = generateText(PASTE_LINES);
+
+	benchmark.begin("paste");
+	for(int i = 0; i < NUM_PASTES; ++i) {
+		editor.setCurrentPos(ofRandom(editor.getNumCharacters()));
+		editor.insertText(block);
+		editor.draw();
+	}
+	benchmark.end(NUM_PASTES, "paste");
+}
+
+//--------------------------------------------------------------
+void ofApp::benchUndo() {
+	unsigned int depth = ofxEditor::getUndoDepth();
+	ofxEditor::setUndoDepth(NUM_UNDOS);
+	editor.clearUndo();
+
+	// only key input is recorded, typing a word & backspacing at a random
+	// pos makes 2 undo actions: the insert & the backspace
+	for(int i = 0; i < NUM_UNDOS/2; ++i) {
+		editor.setCurrentPos(ofRandom(editor.getNumCharacters()));
+		for(const char *c = "word "; *c != '\0'; ++c) {
+			editor.keyPressed(*c);
+		}
+		editor.keyPressed(OF_KEY_BACKSPACE);
+		editor.keyPressed(OF_KEY_BACKSPACE);
+	}
+
+	// don't time empty undos if the history wasn't recorded
+	std::string text = editor.getText();
+	editor.undo();
+	bool undone = (editor.getText() != text);
+	editor.redo();
+	if(!undone) {
+		ofLogError("Benchmark") << "undo didn't change the text, skipping undo";
+		editor.clearUndo();
+		ofxEditor::setUndoDepth(depth);
+		return;
+	}
+
+	benchmark.begin("undo");
+	for(int i = 0; i < NUM_UNDOS; ++i) {
+		editor.undo();
+		editor.draw();
+	}
+	for(int i = 0; i < NUM_UNDOS; ++i) {
+		editor.redo();
+		editor.draw();
+	}
+	benchmark.end(NUM_UNDOS*2, "action");
+
+	editor.clearUndo();
+	ofxEditor::setUndoDepth(depth);
+}
+
+//--------------------------------------------------------------
+void ofApp::benchScroll() {
+	editor.setCurrentLine(0);
+	editor.draw();
+
+	benchmark.begin("scroll");
+	unsigned int frames = 0, line = 0;
+	unsigned int lastLine = editor.getNumLines()-1;
+	while(line < lastLine) {
+		editor.keyPressed(OF_KEY_PAGE_DOWN);
+		editor.draw();
+		frames++;
+		if(editor.getCurrentLine() == line) {
+			break; // stuck
+		}
+		line = editor.getCurrentLine();
+	}
+	benchmark.end(frames, "frame");
+}
+
+//--------------------------------------------------------------
+void ofApp::benchRepl() {
+	ofxRepl repl;
+	repl.resize(WIDTH, HEIGHT);
+	repl.setup();
+
+	benchmark.begin("repl");
+	for(int i = 0; i < NUM_REPL; ++i) {
+		repl.print("line " + ofToString(i) + ": the quick brown fox jumps over the lazy dog\n");
+		if(i % 10 == 0) {
+			repl.draw();
+		}
+	}
+	benchmark.end(NUM_REPL, "print");
+
+	ofLogToConsole(); // the repl grabs log messages
+}
+
+//--------------------------------------------------------------
+std::string ofApp::generateText(unsigned int numLines) {
+	static const char *lines[] = {
+		"-- comment line %d",
+		"function func%d(a, b)",
+		"\tlocal s = \"string value %d\"",
+		"\tif a > %d then",
+		"\t\tprint(s, a * b + 3.14)",
+		"\tend",
+		"\t--[[ multi line",
+		"\tcomment %d ]]",
+		"\treturn a + b",
+		"end",
+		""
+	};
+	const int numTemplates = sizeof(lines)/sizeof(lines[0]);
+	std::string text;
+	char line[128];
+	for(unsigned int i = 0; i < numLines; ++i) {
+		snprintf(line, sizeof(line), lines[i % numTemplates], i);
+		text += line;
+		text += '\n';
+	}
+	return text;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#pragma once
+
+#include "ofMain.h"
+#include "ofxEditor.h"
+#include "ofxRepl.h"
+#include "Benchmark.h"
+
+// headless benchmark driving the editor through common workloads,
+// runs without a window using the headless editor font & exits when done
+//
+// prints time, heap allocations, & font draw calls per op for:
+//
+// open:     open a 100k line Lua file, per line
+// typing:   type 10k chars in the middle of the file & draw, per char
+// paste:    insert 20 line blocks at random positions & draw, per paste
+// undo:     undo & redo a stack of 1000 edits & draw, per undo/redo
+// scroll:   page down from the top to the bottom & draw, per frame
+// repl:     print 10k lines to the REPL & draw every 10, per print
+//
+class ofApp : public ofBaseApp {
+
+	public:
+		void setup();
+		void update();
+
+		void benchOpen();
+		void benchTyping();
+		void benchPaste();
+		void benchUndo();
+		void benchScroll();
+		void benchRepl();
+
+		/// generate Lua-like text with comments, strings & keywords
+		std::string generateText(unsigned int numLines);
+
+		Benchmark benchmark;
+		ofxEditor editor;
+		ofxEditorColorScheme colorScheme;
+		ofxEditorSyntax luaSyntax;
+};
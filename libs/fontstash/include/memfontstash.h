@@ -0,0 +1,216 @@
+//
+// Copyright (c) 2026 Dan Wilcox danomatika@gmail.com
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// CPU-side fontstash render backend which needs no GL context: the atlas is
+// kept as an 8 bit alpha bitmap in memory & draw calls are counted and,
+// optionally, recorded so layout & drawing can run in a headless process
+//
+#ifndef MEMFONTSTASH_H
+#define MEMFONTSTASH_H
+
+FONScontext* memfonsCreate(int width, int height, int flags);
+void memfonsDelete(FONScontext* ctx);
+
+// get the atlas bitmap, 1 alpha byte per pixel
+const unsigned char* memfonsGetAtlas(FONScontext* ctx, int* width, int* height);
+
+// enable/disable recording drawn vertices, default off
+void memfonsSetRecording(FONScontext* ctx, int record);
+
+// get the vertices recorded since the last clear, returns number of vertices
+int memfonsGetVertices(FONScontext* ctx, const float** verts, const float** tcoords, const unsigned int** colors);
+
+// get the number of draw calls & drawn vertices since the last clear
+void memfonsGetDrawStats(FONScontext* ctx, int* draws, int* nverts);
+
+// clear recorded vertices & draw stats
+void memfonsClear(FONScontext* ctx);
+
+unsigned int memfonsRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+
+#endif
+
+#ifdef MEMFONTSTASH_IMPLEMENTATION
+
+struct MEMFONScontext {
+	unsigned char* atlas;
+	int width, height;
+	int record;
+	float* verts;
+	float* tcoords;
+	unsigned int* colors;
+	int nverts, cverts;
+	int draws, drawnVerts;
+};
+typedef struct MEMFONScontext MEMFONScontext;
+
+static int memfons__renderCreate(void* userPtr, int width, int height)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)userPtr;
+	// Create may be called multiple times, delete existing atlas.
+	if (mem->atlas != NULL) {
+		free(mem->atlas);
+		mem->atlas = NULL;
+	}
+	mem->atlas = (unsigned char*)malloc(width * height);
+	if (mem->atlas == NULL) return 0;
+	memset(mem->atlas, 0, width * height);
+	mem->width = width;
+	mem->height = height;
+	return 1;
+}
+
+static int memfons__renderResize(void* userPtr, int width, int height)
+{
+	// Reuse create to resize too, the whole atlas is updated afterwards.
+	return memfons__renderCreate(userPtr, width, height);
+}
+
+static void memfons__renderUpdate(void* userPtr, int* rect, const unsigned char* data)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)userPtr;
+	int w = rect[2] - rect[0];
+	int y;
+
+	if (mem->atlas == NULL || w <= 0) return;
+	for (y = rect[1]; y < rect[3]; y++) {
+		memcpy(&mem->atlas[y * mem->width + rect[0]], &data[y * mem->width + rect[0]], w);
+	}
+}
+
+static int memfons__reserve(MEMFONScontext* mem, int nverts)
+{
+	float* verts;
+	float* tcoords;
+	unsigned int* colors;
+	int cverts = mem->cverts == 0 ? 256 : mem->cverts;
+
+	if (mem->nverts + nverts <= mem->cverts) return 1;
+	while (cverts < mem->nverts + nverts) cverts *= 2;
+	verts = (float*)realloc(mem->verts, sizeof(float) * 2 * cverts);
+	if (verts == NULL) return 0;
+	mem->verts = verts;
+	tcoords = (float*)realloc(mem->tcoords, sizeof(float) * 2 * cverts);
+	if (tcoords == NULL) return 0;
+	mem->tcoords = tcoords;
+	colors = (unsigned int*)realloc(mem->colors, sizeof(unsigned int) * cverts);
+	if (colors == NULL) return 0;
+	mem->colors = colors;
+	mem->cverts = cverts;
+	return 1;
+}
+
+static void memfons__renderDraw(void* userPtr, const float* verts, const float* tcoords, const unsigned int* colors, int nverts)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)userPtr;
+	mem->draws++;
+	mem->drawnVerts += nverts;
+	if (!mem->record || !memfons__reserve(mem, nverts)) return;
+	memcpy(&mem->verts[mem->nverts * 2], verts, sizeof(float) * 2 * nverts);
+	memcpy(&mem->tcoords[mem->nverts * 2], tcoords, sizeof(float) * 2 * nverts);
+	memcpy(&mem->colors[mem->nverts], colors, sizeof(unsigned int) * nverts);
+	mem->nverts += nverts;
+}
+
+static void memfons__renderDelete(void* userPtr)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)userPtr;
+	free(mem->atlas);
+	free(mem->verts);
+	free(mem->tcoords);
+	free(mem->colors);
+	free(mem);
+}
+
+
+FONScontext* memfonsCreate(int width, int height, int flags)
+{
+	FONSparams params;
+	MEMFONScontext* mem;
+
+	mem = (MEMFONScontext*)malloc(sizeof(MEMFONScontext));
+	if (mem == NULL) goto error;
+	memset(mem, 0, sizeof(MEMFONScontext));
+
+	memset(&params, 0, sizeof(params));
+	params.width = width;
+	params.height = height;
+	params.flags = (unsigned char)flags;
+	params.renderCreate = memfons__renderCreate;
+	params.renderResize = memfons__renderResize;
+	params.renderUpdate = memfons__renderUpdate;
+	params.renderDraw = memfons__renderDraw;
+	params.renderDelete = memfons__renderDelete;
+	params.userPtr = mem;
+
+	return fonsCreateInternal(&params);
+
+error:
+	if (mem != NULL) free(mem);
+	return NULL;
+}
+
+void memfonsDelete(FONScontext* ctx)
+{
+	fonsDeleteInternal(ctx);
+}
+
+const unsigned char* memfonsGetAtlas(FONScontext* ctx, int* width, int* height)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)ctx->params.userPtr;
+	fons__flush(ctx); // apply pending glyph updates
+	if (width != NULL) *width = mem->width;
+	if (height != NULL) *height = mem->height;
+	return mem->atlas;
+}
+
+void memfonsSetRecording(FONScontext* ctx, int record)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)ctx->params.userPtr;
+	mem->record = record;
+}
+
+int memfonsGetVertices(FONScontext* ctx, const float** verts, const float** tcoords, const unsigned int** colors)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)ctx->params.userPtr;
+	if (verts != NULL) *verts = mem->verts;
+	if (tcoords != NULL) *tcoords = mem->tcoords;
+	if (colors != NULL) *colors = mem->colors;
+	return mem->nverts;
+}
+
+void memfonsGetDrawStats(FONScontext* ctx, int* draws, int* nverts)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)ctx->params.userPtr;
+	if (draws != NULL) *draws = mem->draws;
+	if (nverts != NULL) *nverts = mem->drawnVerts;
+}
+
+void memfonsClear(FONScontext* ctx)
+{
+	MEMFONScontext* mem = (MEMFONScontext*)ctx->params.userPtr;
+	mem->nverts = 0;
+	mem->draws = 0;
+	mem->drawnVerts = 0;
+}
+
+unsigned int memfonsRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+{
+	return (r) | (g << 8) | (b << 16) | (a << 24);
+}
+
+#endif
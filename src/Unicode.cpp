@@ -25,6 +25,9 @@
  */
 #include "Unicode.h"
 
+#include <cstring>
+#include <stdint.h>
+
 using namespace std;
 
 #define MASKBITS   0x3F
@@ -35,6 +38,9 @@ using namespace std;
 #define MASK5BYTES 0xF8
 #define MASK6BYTES 0xFC
 
+#define ASCII_WORD   0x8080808080808080ULL // high bit of each byte in 8 bytes
+#define REPLACEMENT  0xFFFD // replacement char for malformed sequences
+
 //--------------------------------------------------------------
 unsigned int wchar_width(int input) {
 	if((input & MASK6BYTES) == MASK6BYTES) {
@@ -59,46 +65,39 @@ unsigned int wchar_width(int input) {
 
 //--------------------------------------------------------------
 std::string wchar_to_string(char32_t input) {
-	string output;
+	char bytes[4];
+	return string(bytes, wchar_to_utf8(input, bytes));
+}
+
+//--------------------------------------------------------------
+unsigned int wchar_to_utf8(char32_t input, char *output) {
+	if((input >= 0xD800 && input <= 0xDFFF) || input > 0x10FFFF) {
+		input = REPLACEMENT;
+	}
 	// 0xxxxxxx
 	if(input < 0x80) {
-		output.push_back((char)input);
+		output[0] = (char)input;
+		return 1;
 	}
 	// 110xxxxx 10xxxxxx
 	else if(input < 0x800) {
-		output.push_back((char)(MASK2BYTES | input >> 6));
-		output.push_back((char)(MASKBYTE | (input & MASKBITS)));
+		output[0] = (char)(MASK2BYTES | input >> 6);
+		output[1] = (char)(MASKBYTE | (input & MASKBITS));
+		return 2;
 	}
 	// 1110xxxx 10xxxxxx 10xxxxxx
 	else if(input < 0x10000) {
-		output.push_back((char)(MASK3BYTES | (input >> 12)));
-		output.push_back((char)(MASKBYTE | (input >> 6 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input & MASKBITS)));
+		output[0] = (char)(MASK3BYTES | (input >> 12));
+		output[1] = (char)(MASKBYTE | (input >> 6 & MASKBITS));
+		output[2] = (char)(MASKBYTE | (input & MASKBITS));
+		return 3;
 	}
 	// 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-	else if(input < 0x200000) {
-		output.push_back((char)(MASK4BYTES | (input >> 18)));
-		output.push_back((char)(MASKBYTE | (input >> 12 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input >> 6 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input & MASKBITS)));
-	}
-	// 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-	else if(input < 0x4000000) {
-		output.push_back((char)(MASK5BYTES | (input >> 24)));
-		output.push_back((char)(MASKBYTE | (input >> 18 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input >> 12 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input >> 6 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input & MASKBITS)));
-	}
-	// 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-	else if(input < 0x8000000) {
-		output.push_back((char)(MASK6BYTES | (input >> 30)));
-		output.push_back((char)(MASKBYTE | (input >> 18 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input >> 12 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input >> 6 & MASKBITS)));
-		output.push_back((char)(MASKBYTE | (input & MASKBITS)));
-	}
-	return output;
+	output[0] = (char)(MASK4BYTES | (input >> 18));
+	output[1] = (char)(MASKBYTE | (input >> 12 & MASKBITS));
+	output[2] = (char)(MASKBYTE | (input >> 6 & MASKBITS));
+	output[3] = (char)(MASKBYTE | (input & MASKBITS));
+	return 4;
 }
 
 //--------------------------------------------------------------
@@ -149,63 +148,164 @@ char32_t string_to_wchar(const std::string &input) {
 //--------------------------------------------------------------
 string wstring_to_string(const u32string &input) {
 	string output;
-	for(char32_t c: input) {
-		output.append(wchar_to_string(c));
-	}
+	wstring_append(output, input);
 	return output;
 }
 
 //--------------------------------------------------------------
 u32string string_to_wstring(const string &input) {
 	u32string output;
-	for(unsigned int i = 0; i < input.size();) {
-		char32_t ch;
-		// 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-		if((input[i] & MASK6BYTES) == MASK6BYTES) {
-			ch = ((input[i] & 0x01) << 30) |
-			     ((input[i+1] & MASKBITS) << 24) |
-				 ((input[i+2] & MASKBITS) << 18) |
-				 ((input[i+3] & MASKBITS) << 12) |
-				 ((input[i+4] & MASKBITS) << 6) |
-				  (input[i+5] & MASKBITS);
-			i += 6;
+	string_append(output, input);
+	return output;
+}
+
+// BUFFERS
+
+/// number of UTF-8 bytes for a wide char, matches wchar_to_utf8()
+static inline unsigned int utf8_length(char32_t input) {
+	if(input < 0x80) {return 1;}
+	else if(input < 0x800) {return 2;}
+	else if(input < 0x10000 || input > 0x10FFFF) {return 3;} // incl. surrogates & replaced
+	return 4;
+}
+
+/// decode a multi byte sequence starting at i, advances i past the sequence
+/// or the malformed bytes & returns false if the sequence is truncated, has
+/// bad continuation bytes, is overlong, or is a surrogate or out of range
+static inline bool utf8_decode(const unsigned char *input, size_t length, size_t &i, char32_t &output) {
+	unsigned char c = input[i];
+	unsigned int bytes;
+	char32_t min;
+	if((c & MASK3BYTES) == MASK2BYTES) { // 110xxxxx
+		bytes = 2;
+		output = c & 0x1F;
+		min = 0x80;
+	}
+	else if((c & MASK4BYTES) == MASK3BYTES) { // 1110xxxx
+		bytes = 3;
+		output = c & 0x0F;
+		min = 0x800;
+	}
+	else if((c & MASK5BYTES) == MASK4BYTES) { // 11110xxx
+		bytes = 4;
+		output = c & 0x07;
+		min = 0x10000;
+	}
+	else { // stray continuation byte or invalid lead byte
+		i++;
+		return false;
+	}
+	unsigned int j = 1;
+	for(; j < bytes; ++j) {
+		if(i+j >= length || (input[i+j] & MASK2BYTES) != MASKBYTE) {
+			i += j;
+			return false;
+		}
+		output = (output << 6) | (input[i+j] & MASKBITS);
+	}
+	i += bytes;
+	return output >= min && output <= 0x10FFFF && (output < 0xD800 || output > 0xDFFF);
+}
+
+//--------------------------------------------------------------
+void wstring_append(std::string &output, const char32_t *input, size_t length) {
+	size_t bytes = 0;
+	for(size_t i = 0; i < length; ++i) {
+		bytes += utf8_length(input[i]);
+	}
+	size_t start = output.size();
+	output.resize(start+bytes);
+	char *out = &output[0]+start;
+	for(size_t i = 0; i < length; ++i) {
+		if(input[i] < 0x80) {
+			*out++ = (char)input[i];
 		}
-		// 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-		else if((input[i] & MASK5BYTES) == MASK5BYTES) {
-			ch = ((input[i] & 0x03) << 24) |
-			     ((input[i+1] & MASKBITS) << 18) |
-				 ((input[i+2] & MASKBITS) << 12) |
-				 ((input[i+3] & MASKBITS) << 6) |
-				 (input[i+4] & MASKBITS);
-			i += 5;
+		else {
+			out += wchar_to_utf8(input[i], out);
 		}
-		// 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-		else if((input[i] & MASK4BYTES) == MASK4BYTES) {
-			ch = ((input[i] & 0x07) << 18) |
-			     ((input[i+1] & MASKBITS) << 12) |
-				 ((input[i+2] & MASKBITS) << 6) |
-				  (input[i+3] & MASKBITS);
-			i += 4;
+	}
+}
+
+//--------------------------------------------------------------
+void wstring_append(std::string &output, const std::u32string &input) {
+	wstring_append(output, input.data(), input.size());
+}
+
+//--------------------------------------------------------------
+void string_append(std::u32string &output, const char *input, size_t length) {
+	const unsigned char *in = (const unsigned char *)input;
+	size_t start = output.size(), n = 0, i = 0;
+	output.resize(start+length); // never more chars than bytes
+	char32_t *out = &output[0]+start;
+	while(i < length) {
+		
+		// ASCII run? check & widen 8 bytes at a time
+		while(i+8 <= length) {
+			uint64_t word;
+			memcpy(&word, in+i, 8);
+			if(word & ASCII_WORD) {
+				break;
+			}
+			for(int j = 0; j < 8; ++j) {
+				out[n+j] = in[i+j];
+			}
+			i += 8;
+			n += 8;
 		}
-		// 1110xxxx 10xxxxxx 10xxxxxx
-		else if((input[i] & MASK3BYTES) == MASK3BYTES) {
-			ch = ((input[i] & 0x0F) << 12) |
-			     ((input[i+1] & MASKBITS) << 6) |
-				  (input[i+2] & MASKBITS);
-		 i += 3;
+		if(i >= length) {
+			break;
 		}
-		// 110xxxxx 10xxxxxx
-		else if((input[i] & MASK2BYTES) == MASK2BYTES) {
-			ch = ((input[i] & 0x1F) << 6) |
-			      (input[i+1] & MASKBITS);
-			i += 2;
+		
+		// single char
+		if(in[i] < 0x80) {
+			out[n++] = in[i++];
 		}
-		// 0xxxxxxx
 		else {
-			ch = input[i];
-			i += 1;
+			char32_t ch;
+			out[n++] = (utf8_decode(in, length, i, ch) ? ch : REPLACEMENT);
 		}
-		output.push_back(ch);
 	}
-	return output;
+	output.resize(start+n);
+}
+
+//--------------------------------------------------------------
+void string_append(std::u32string &output, const std::string &input) {
+	string_append(output, input.data(), input.size());
+}
+
+//--------------------------------------------------------------
+bool string_is_valid(const char *input, size_t length, size_t *invalid) {
+	const unsigned char *in = (const unsigned char *)input;
+	size_t i = 0;
+	while(i < length) {
+		while(i+8 <= length) {
+			uint64_t word;
+			memcpy(&word, in+i, 8);
+			if(word & ASCII_WORD) {
+				break;
+			}
+			i += 8;
+		}
+		if(i >= length) {
+			break;
+		}
+		if(in[i] < 0x80) {
+			i++;
+			continue;
+		}
+		size_t pos = i;
+		char32_t ch;
+		if(!utf8_decode(in, length, i, ch)) {
+			if(invalid) {
+				*invalid = pos;
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+bool string_is_valid(const std::string &input, size_t *invalid) {
+	return string_is_valid(input.data(), input.size(), invalid);
 }
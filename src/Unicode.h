@@ -29,6 +29,7 @@
  *
  */
 #include <string>
+#include <cstddef>
 
 /// get the number of bytes for a UTF-8 wchar from a (suspected) leading byte
 unsigned int wchar_width(int input);
@@ -36,6 +37,13 @@ unsigned int wchar_width(int input);
 /// split a single wide char value into UTF-8 bytes
 std::string wchar_to_string(char32_t input);
 
+/// split a single wide char value into UTF-8 bytes written to output which
+/// must have room for 4 bytes, returns the number of bytes written
+///
+/// surrogates & values above U+10FFFF aren't valid UTF-8 & are written as the
+/// U+FFFD replacement char, matching what string_append() decodes them to
+unsigned int wchar_to_utf8(char32_t input, char *output);
+
 /// split a set of UTF-8 bytes into the first single wide char value found
 char32_t string_to_wchar(const std::string &input);
 
@@ -44,3 +52,18 @@ std::string wstring_to_string(const std::u32string &input);
 
 /// parse UTF-8 bytes into wide chars
 std::u32string string_to_wstring(const std::string &input);
+
+/// append wide chars to output as UTF-8 bytes, output is resized once
+/// so a reused output string does not allocate once it is large enough
+void wstring_append(std::string &output, const char32_t *input, size_t length);
+void wstring_append(std::string &output, const std::u32string &input);
+
+/// append UTF-8 bytes to output as wide chars, ASCII runs are converted a
+/// word at a time & malformed sequences are replaced with U+FFFD
+void string_append(std::u32string &output, const char *input, size_t length);
+void string_append(std::u32string &output, const std::string &input);
+
+/// returns true if the bytes are valid UTF-8, optionally sets invalid to the
+/// offset of the first malformed sequence
+bool string_is_valid(const char *input, size_t length, size_t *invalid=NULL);
+bool string_is_valid(const std::string &input, size_t *invalid=NULL);
@@ -50,6 +50,16 @@
 // timeout between chars when building an undo action
 #define UNDO_TIMEOUT 1000
 
+// min number of pending lines to parse in the background
+#define HIGHLIGHT_THREAD_LINES 2000
+
+// max number of pending lines to parse right away when drawing while the
+// background parser is running
+#define HIGHLIGHT_SYNC_LINES 500
+
+// max number of lines searched for a matching char
+#define MATCHING_CHAR_LINES 5000
+
 // uncomment to see the viewport and auto focus bounding boxes
 //#define DEBUG_AUTO_FOCUS
 
@@ -73,7 +83,8 @@ float ofxEditor::s_autoFocusMinScale = 0.5;
 float ofxEditor::s_autoFocusMaxScale = 5.0;
 
 bool ofxEditor::s_undo = true;
-unsigned int ofxEditor::s_undoMaxDepth = 10;
+unsigned int ofxEditor::s_undoMaxDepth = 0;
+size_t ofxEditor::s_undoMaxBytes = 1024*1024;
 
 // use CMD on OSX, CTRL for Windows & Linux by default
 #ifdef __APPLE__
@@ -94,6 +105,7 @@ ofxEditor::ofxEditor() {
 	m_position = 0;
 	m_desiredXPos = 0;
 	m_visibleWidth = 0;
+	m_visibleLines = 0; // set by resize()
 	
 	m_selection = NONE;
 	m_highlightStart = 0;
@@ -110,6 +122,14 @@ ofxEditor::ofxEditor() {
 	
 	m_colorScheme = NULL;
 	m_syntax = NULL;
+	m_textLinesSyntax = NULL;
+	m_textLinesSyntaxRevision = 0;
+	m_textLinesParsed = 0;
+	m_highlighter = NULL;
+	m_highlighterRevision = 0;
+	m_matchingChars.valid = false;
+	m_lineCacheStyle = LineCacheStyle();
+	m_lineCacheRevision = 1;
 	m_lineWrapping = false;
 	m_lineNumbers = false;
 	m_lineNumWidth = 0;
@@ -126,8 +146,6 @@ ofxEditor::ofxEditor() {
 	m_scale = 1.0;
 	m_BBMinX = 0; m_BBMaxX = 0;
 	m_BBMinY = 0; m_BBMaxY = 0;
-	
-	m_undoPos = -1;
 }
 
 //--------------------------------------------------------------
@@ -142,6 +160,7 @@ ofxEditor::ofxEditor(ofxEditorSettings &sharedSettings) {
 	m_position = 0;
 	m_desiredXPos = 0;
 	m_visibleWidth = 0;
+	m_visibleLines = 0; // set by resize()
 	
 	m_selection = NONE;
 	m_highlightStart = 0;
@@ -158,6 +177,14 @@ ofxEditor::ofxEditor(ofxEditorSettings &sharedSettings) {
 	
 	m_colorScheme = NULL;
 	m_syntax = NULL;
+	m_textLinesSyntax = NULL;
+	m_textLinesSyntaxRevision = 0;
+	m_textLinesParsed = 0;
+	m_highlighter = NULL;
+	m_highlighterRevision = 0;
+	m_matchingChars.valid = false;
+	m_lineCacheStyle = LineCacheStyle();
+	m_lineCacheRevision = 1;
 	m_lineWrapping = false;
 	m_lineNumbers = false;
 	m_lineNumWidth = 0;
@@ -174,12 +201,12 @@ ofxEditor::ofxEditor(ofxEditorSettings &sharedSettings) {
 	m_scale = 1.0;
 	m_BBMinX = 0; m_BBMaxX = 0;
 	m_BBMinY = 0; m_BBMaxY = 0;
-	
-	m_undoPos = -1;
 }
 
 //--------------------------------------------------------------
 ofxEditor::~ofxEditor() {
+	closeJournal();
+	stopHighlighter();
 	if(!m_sharedSettings) {
 		delete m_settings;
 	}
@@ -188,7 +215,7 @@ ofxEditor::~ofxEditor() {
 // STATIC SETTINGS
 
 //--------------------------------------------------------------
-bool ofxEditor::loadFont(const std::string &font, int size) {
+bool ofxEditor::loadFont(const std::string &font, int size, bool headless) {
 
 	bool loaded = false;
 	
@@ -202,7 +229,7 @@ bool ofxEditor::loadFont(const std::string &font, int size) {
 	if(s_font == NULL) {
 		s_font = ofPtr<ofxEditorFont>(new ofxEditorFont());
 	}
-	if(s_font->load(font, size)) {
+	if(s_font->load(font, size, 512, headless)) {
 		s_charWidth = s_font->characterWidth(' ');
 		s_zeroWidth = s_font->characterWidth('0');
 		s_charHeight = s_font->stringHeight("#ITqg"); // catch tall chars & chars which may hang down
@@ -219,6 +246,11 @@ bool ofxEditor::isFontLoaded() {
 	return s_font.get();
 }
 
+//--------------------------------------------------------------
+std::shared_ptr<ofxEditorFont> ofxEditor::getFont() {
+	return s_font;
+}
+
 //--------------------------------------------------------------
 int ofxEditor::getCharWidth() {
 	return s_charWidth;
@@ -299,6 +331,16 @@ unsigned int ofxEditor::getUndoDepth() {
 	return s_undoMaxDepth;
 }
 
+//--------------------------------------------------------------
+void ofxEditor::setUndoMaxBytes(size_t bytes) {
+	s_undoMaxBytes = bytes;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditor::getUndoMaxBytes() {
+	return s_undoMaxBytes;
+}
+
 // MAIN
 
 //--------------------------------------------------------------
@@ -369,228 +411,296 @@ void ofxEditor::draw() {
 		// for line numbers
 		int currentLine = 0;
 
-		// draw text
+		// draw text, glyphs are batched & drawn together after the highlights
+		s_font->beginBatch();
 		if(m_colorScheme) { // with colorScheme
 			ofFill();
 			
 			s_font->setColor(m_settings->getTextColor(), m_settings->getAlpha());
 			s_font->setShadowColor(m_settings->getTextShadowColor(), m_settings->getAlpha());
 			
+			// sync with any text changes & parse pending visible lines, lines
+			// far past the parsed lines are drawn plain until the background
+			// parser catches up, it's restarted once edits pause
+			updateTextBlocks();
+			updateHighlighter();
+			size_t line = m_text.getLineForPos(m_topTextPosition);
+			if(line > m_textLinesParsed + HIGHLIGHT_SYNC_LINES) {
+				parsePlainTextLines(line, line + m_visibleLines);
+			}
+			else {
+				parseTextLinesTo(line + m_visibleLines);
+			}
+			
 			// start with line number
 			if(m_lineNumbers) {
-				currentLine = lineNumberForPos(m_topTextPosition);
+				currentLine = line;
 				drawLineNumber(x, y, currentLine);
 			}
 			
+			// start at the first visible line using it's cached state for
+			// syntax which began on a preceding line
 			bool string = false;
 			bool comment = false;
 			bool preprocessor = false;
-			for(list<TextBlock>::iterator iter = m_textBlocks.begin();
-			    iter != m_textBlocks.end() && m_displayedLineCount < m_visibleLines; iter++) {
+			if(line < m_textLinesParsed) {
+				ParserState &state = m_textLines[line].state;
+				textPos = m_text.getLineStart(line);
+				if(state.string || state.stringLiteral) {
+					string = true;
+					s_font->setColor(m_colorScheme->getStringColor(), m_settings->getAlpha());
+				}
+				else if(state.multiComment) {
+					comment = true;
+					s_font->setColor(m_colorScheme->getCommentColor(), m_settings->getAlpha());
+				}
+			}
 			
-				TextBlock &tb = (*iter);
+			// unchanged lines without highlights are redrawn from their cached
+			// glyphs, the ENDLINE & line number are always drawn normally
+			updateLineCacheStyle();
+			size_t firstLine = line;
+			for(; line < m_textLines.size() && m_displayedLineCount < m_visibleLines; ++line) {
+				TextLine &textLine = m_textLines[line];
+				vector<TextBlock> &blocks = textLine.blocks;
+				unsigned int lineStart = m_text.getLineStart(line);
+				textPos = lineStart;
+				size_t block = 0, cachedBlocks = blocks.size();
+				if(cachedBlocks > 0 && blocks[cachedBlocks-1].type == ENDLINE) {
+					cachedBlocks--;
+				}
+				bool capturing = false;
+				if(lineStart >= m_topTextPosition && !rangeHasHighlights(lineStart, m_text.getLineEnd(line))) {
+					if(drawLineCache(textLine.cache, x, y, textPos, string, comment, preprocessor)) {
+						block = cachedBlocks;
+					}
+					else {
+						beginLineCache(textLine.cache, x, y);
+						capturing = true;
+					}
+				}
+				for(; block < blocks.size() && m_displayedLineCount < m_visibleLines; ++block) {
+				
+					if(capturing && block == cachedBlocks) {
+						endLineCache(line, textLine.cache, x, y, textPos - lineStart, string, comment, preprocessor);
+						capturing = false;
+					}
+				
+					TextBlock &tb = blocks[block];
+				
+					// burn through text blocks until we get to the top text position
+					if(textPos < m_topTextPosition) {
+						// set preceding colors in the case of syntax which could begin on the preceeding line
+						switch(tb.type) {
+							case STRING_BEGIN: case LITERAL_BEGIN:
+								string = true;
+								s_font->setColor(m_colorScheme->getStringColor(), m_settings->getAlpha());
+								break;
+							case STRING_END: case LITERAL_END:
+								string = false;
+								s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+								break;
+							case COMMENT_BEGIN:
+								comment = true;
+								s_font->setColor(m_colorScheme->getCommentColor(), m_settings->getAlpha());
+								break;
+							case COMMENT_END:
+								comment = false;
+								s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+								break;
+							case PREPROCESSOR_BEGIN:
+								preprocessor = true;
+								s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
+								break;
+							case PREPROCESSOR_END:
+								preprocessor = false;
+								s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+								break;
+							default:
+								break;
+						}
+						if(tb.type == ENDLINE) {
+							textPos++;
+						}
+						else {
+							textPos += tb.length;
+						}
+						continue;
+					}
 				
-				// burn through text blocks until we get to the first visible line
-				if(textPos < m_topTextPosition) {
-					// set preceding colors in the case of syntax which could begin on the preceeding line
+					// set font color based on block type
 					switch(tb.type) {
-						case STRING_BEGIN: case LITERAL_BEGIN:
+				
+						case UNKNOWN:
+							ofLogWarning("ofxEditor") << "trying to draw UNKNOWN text block, contents: " << wstring_to_string(getBlockText(lineStart, tb));
+							continue; // skip
+						
+						case WORD:
+							if(string) break;
+							if(preprocessor) {
+								s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
+							}
+							else if(!comment) {
+								if(m_syntax) {
+									switch(tb.word) {
+										case ofxEditorSyntax::KEYWORD:
+											s_font->setColor(m_colorScheme->getKeywordColor(), m_settings->getAlpha());
+											break;
+										case ofxEditorSyntax::TYPENAME:
+											s_font->setColor(m_colorScheme->getTypenameColor(), m_settings->getAlpha());
+											break;
+										case ofxEditorSyntax::FUNCTION:
+											s_font->setColor(m_colorScheme->getFunctionColor(), m_settings->getAlpha());
+											break;
+										default:
+											s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+											break;
+									}
+								}
+								else {
+									s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+								}
+							}
+							break;
+						
+						case STRING_BEGIN:
 							string = true;
 							s_font->setColor(m_colorScheme->getStringColor(), m_settings->getAlpha());
-							break;
-						case STRING_END: case LITERAL_END:
+							continue; // nothing to draw
+						
+						case STRING_END:
 							string = false;
-							s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+							if(preprocessor) {
+								s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
+							}
+							else {
+								s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+							}
+							continue; // nothing to draw
+						
+						case NUMBER:
+							if(!string && !comment) {
+								s_font->setColor(m_colorScheme->getNumberColor(), m_settings->getAlpha());
+							}
+							break;
+					
+						case MATCHING_CHAR: case OPERATOR_CHAR: case PUNCTUATION_CHAR:
+							if(!comment) {
+								s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+							}
 							break;
+					
 						case COMMENT_BEGIN:
 							comment = true;
 							s_font->setColor(m_colorScheme->getCommentColor(), m_settings->getAlpha());
-							break;
+							continue; // nothing to draw
+						
 						case COMMENT_END:
 							comment = false;
 							s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
-							break;
+							continue; // nothing to draw
+						
+						case LITERAL_BEGIN:
+							string = true;
+							s_font->setColor(m_colorScheme->getStringColor(), m_settings->getAlpha());
+							continue; // nothing to draw
+						
+						case LITERAL_END:
+							string = false;
+							s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+							continue; // nothing to draw
+						
 						case PREPROCESSOR_BEGIN:
 							preprocessor = true;
 							s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
-							break;
+							continue; // nothing to draw
+						
 						case PREPROCESSOR_END:
 							preprocessor = false;
 							s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+							continue; // nothing to draw
+					
+						case SPACE: case TAB: case ENDLINE: // for fonts with whitespace glyphs
+							if(preprocessor) {
+								s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
+							}
+							else if(!string && !comment) {
+								s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+							}
 							break;
-						default:
-							break;
-					}
-					if(tb.type == ENDLINE) {
-						textPos++;
 					}
-					else {
-						textPos += tb.text.length();
-					}
-					continue;
-				}
-				
-				// set font color based on block type
-				switch(tb.type) {
 				
-					case UNKNOWN:
-						ofLogWarning("ofxEditor") << "trying to draw UNKNOWN text block, contents: " << wstring_to_string(tb.text);
-						continue; // skip
+					// draw block chars
+					for(int i = 0; i < tb.length; ++i) {
 						
-					case WORD:
-						if(string) break;
-						if(preprocessor) {
-							s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
-						}
-						else if(!comment) {
-							if(m_syntax) {
-								switch(m_syntax->getWordType(tb.text)) {
-									case ofxEditorSyntax::KEYWORD:
-										s_font->setColor(m_colorScheme->getKeywordColor(), m_settings->getAlpha());
-										break;
-									case ofxEditorSyntax::TYPENAME:
-										s_font->setColor(m_colorScheme->getTypenameColor(), m_settings->getAlpha());
-										break;
-									case ofxEditorSyntax::FUNCTION:
-										s_font->setColor(m_colorScheme->getFunctionColor(), m_settings->getAlpha());
-										break;
-									default:
-										s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
-										break;
-								}
-							}
-							else {
-								s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+						char32_t c = m_text[lineStart+tb.offset+i];
+					
+						// line wrap at the block level
+						if(m_lineWrapping && x >= m_visibleWidth) {
+							y += s_charHeight;
+							expandBoundingBox(x, y);
+							x = 0;
+							if(m_lineNumbers) { // pad for line numbers
+								x += m_lineNumWidth;
 							}
+							m_displayedLineCount++;
 						}
-						break;
-						
-					case STRING_BEGIN:
-						string = true;
-						s_font->setColor(m_colorScheme->getStringColor(), m_settings->getAlpha());
-						continue; // nothing to draw
-						
-					case STRING_END:
-						string = false;
-						if(preprocessor) {
-							s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
-						}
-						else {
-							s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
-						}
-						continue; // nothing to draw
-						
-					case NUMBER:
-						if(!string && !comment) {
-							s_font->setColor(m_colorScheme->getNumberColor(), m_settings->getAlpha());
-						}
-						break;
 					
-					case MATCHING_CHAR: case OPERATOR_CHAR: case PUNCTUATION_CHAR:
-						if(!comment) {
-							s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+						// draw matching chars highlight
+						if(!comment && m_selection == NONE && textPos >= m_matchingCharsHighlight[0] && textPos <= m_matchingCharsHighlight[1]) {
+							drawMatchingCharBlock(c, x, y);
 						}
-						break;
-					
-					case COMMENT_BEGIN:
-						comment = true;
-						s_font->setColor(m_colorScheme->getCommentColor(), m_settings->getAlpha());
-						continue; // nothing to draw
-						
-					case COMMENT_END:
-						comment = false;
-						s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
-						continue; // nothing to draw
-						
-					case LITERAL_BEGIN:
-						string = true;
-						s_font->setColor(m_colorScheme->getStringColor(), m_settings->getAlpha());
-						continue; // nothing to draw
-						
-					case LITERAL_END:
-						string = false;
-						s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
-						continue; // nothing to draw
-						
-					case PREPROCESSOR_BEGIN:
-						preprocessor = true;
-						s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
-						continue; // nothing to draw
-						
-					case PREPROCESSOR_END:
-						preprocessor = false;
-						s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
-						continue; // nothing to draw
 					
-					case SPACE: case TAB: case ENDLINE: // for fonts with whitespace glyphs
-						if(preprocessor) {
-							s_font->setColor(m_colorScheme->getPreprocessorColor(), m_settings->getAlpha());
+						// draw selection
+						if(m_selection != NONE && textPos >= m_highlightStart && textPos < m_highlightEnd) {
+							drawSelectionCharBlock(c, x, y);
 						}
-						else if(!string && !comment) {
-							s_font->setColor(m_colorScheme->getTextColor(), m_settings->getAlpha());
+
+						// draw flash
+						if (m_flashSelection && textPos >= m_flashStart && textPos < m_flashEnd) {
+							drawFlashCharBlock(c, x, y);
 						}
-						break;
-				}
-				
-				// draw block chars
-				for(int i = 0; i < tb.text.length(); ++i) {
 					
-					// line wrap at the block level
-					if(m_lineWrapping && x >= m_visibleWidth) {
-						y += s_charHeight;
-						expandBoundingBox(x, y);
-						x = 0;
-						if(m_lineNumbers) { // pad for line numbers
-							x += m_lineNumWidth;
+						// draw cursor
+						if(textPos == m_position) {
+							drawCursor(x, y);
+							expandBoundingBox(x+s_zeroWidth, y); // extra space for the cursor
+							drawnCursor = true;
 						}
-						m_displayedLineCount++;
-					}
 					
-					// draw matching chars highlight
-					if(!comment && m_selection == NONE && textPos >= m_matchingCharsHighlight[0] && textPos <= m_matchingCharsHighlight[1]) {
-						drawMatchingCharBlock(tb.text[i], x, y);
-					}
-					
-					// draw selection
-					if(m_selection != NONE && textPos >= m_highlightStart && textPos < m_highlightEnd) {
-						drawSelectionCharBlock(tb.text[i], x, y);
-					}
-
-					// draw flash
-					if (m_flashSelection && textPos >= m_flashStart && textPos < m_flashEnd) {
-						drawFlashCharBlock(tb.text[i], x, y);
+						// draw chars
+						switch(tb.type) {
+							case ENDLINE:
+								x = 0;
+								y += s_charHeight;
+								textPos++;
+								m_displayedLineCount++;
+								if(m_lineNumbers) {
+									drawLineNumber(x, y, currentLine);
+								}
+								break;
+							case TAB:
+								x += s_charWidth * m_settings->getTabWidth();
+								textPos++;
+								break;
+							default:
+								x = s_font->drawCharacter(c, x, y, s_textShadow);
+								textPos++;
+								break;
+						}
+						expandBoundingBox(x,y);
 					}
-					
-					// draw cursor
-					if(textPos == m_position) {
-						drawCursor(x, y);
-						expandBoundingBox(x+s_zeroWidth, y); // extra space for the cursor
-						drawnCursor = true;
+				}
+				if(capturing) { // last line or stopped before the line end
+					if(block == cachedBlocks) {
+						endLineCache(line, textLine.cache, x, y, textPos - lineStart, string, comment, preprocessor);
 					}
-					
-					// draw chars
-					switch(tb.type) {
-						case ENDLINE:
-							x = 0;
-							y += s_charHeight;
-							textPos++;
-							m_displayedLineCount++;
-							if(m_lineNumbers) {
-								drawLineNumber(x, y, currentLine);
-							}
-							break;
-						case TAB:
-							x += s_charWidth * m_settings->getTabWidth();
-							textPos++;
-							break;
-						default:
-							x = s_font->drawCharacter(tb.text[i], x, y, s_textShadow);
-							textPos++;
-							break;
+					else {
+						cancelLineCache();
 					}
-					expandBoundingBox(x,y);
 				}
 			}
+			trimLineCaches(firstLine, line);
 		}
 		else { // without syntax highlighting
 			ofFill();
@@ -679,6 +789,7 @@ void ofxEditor::draw() {
 			drawCursor(x, y);
 			expandBoundingBox(x+s_zeroWidth, y); // extra space for the cursor
 		}
+		s_font->endBatch();
 	
 		// calculate auto focus bounding box and scaling
 		if(m_autoFocus) {
@@ -753,7 +864,7 @@ void ofxEditor::keyPressed(int key) {
 			case 'a': case 10: // clear all text
 				if(ofGetKeyPressed(OF_KEY_SHIFT)) {
 					if(s_undo) {
-						updateUndo(ACTION_DELETE, 0, U"", m_text);
+						updateUndo(ACTION_DELETE, 0, U"", m_text.getText());
 					}
 					clearText();
 				}
@@ -790,8 +901,10 @@ void ofxEditor::keyPressed(int key) {
 				undo();
 				break;
 				
-			case 'y': case 25: // redo
-				redo();
+			case 'y': case 25: // redo, shift redoes the next older branch
+				if(!ofGetKeyPressed(OF_KEY_SHIFT) || switchRedoBranch()) {
+					redo();
+				}
 				break;
 		}
 	}
@@ -889,13 +1002,7 @@ void ofxEditor::keyPressed(int key) {
 				int twoPageLen = onePageLen*2;
 				
 				// count number of lines to the end of the buffer
-				int numLines = 0;
-				unsigned int i = m_position;
-				size_t step = 0;
-				while((step = m_text.find(L'\n', i)) != u32string::npos){
-					numLines++;
-					i = step+1;
-				}
+				int numLines = m_text.getNumLineBreaks() - m_text.getLineForPos(m_position);
 			
 				// choose num to move based on if we're close to the end
 				if(numLines >= twoPageLen-1) { // at least 2 pages from the end
@@ -915,10 +1022,8 @@ void ofxEditor::keyPressed(int key) {
 				}
 				
 				// move top position down by num lines
-				while(numLines > 0) {
-					if(m_text[m_topTextPosition++] == '\n') {
-						numLines--;
-					}
+				if(numLines > 0) {
+					m_topTextPosition = m_text.getLineStart(m_text.getLineForPos(m_topTextPosition)+numLines);
 				}
 				m_flash = HALF_FLASH_RATE; // show cursor after moving
 				break;
@@ -1130,15 +1235,14 @@ void ofxEditor::resize(int width, int height) {
 
 //--------------------------------------------------------------
 bool ofxEditor::openFile(std::string filename) {
-	ofFile file;
-	if(!file.open(ofToDataPath(filename), ofFile::ReadOnly)) {
+	int line = textReplacing();
+	if(!m_text.assignFile(ofToDataPath(filename))) {
 		ofLogError("ofxEditor") << "couldn't load \""
 			<< ofFilePath::getFileName(filename) << "\"";
 		return false;
 	}
 	setFileExtSyntax(ofFilePath::getFileExt(filename));
-	setText(file.readToBuffer().getText());
-	file.close();
+	textReplaced(line);
 	m_position = 0;
 	return true;
 }
@@ -1166,37 +1270,33 @@ std::u32string ofxEditor::getWideText() {
 	if(m_selection != NONE) {
 		return m_text.substr(m_highlightStart, m_highlightEnd-m_highlightStart);
 	}
-	return m_text;
+	return m_text.getText();
 }
 
 //--------------------------------------------------------------
 std::string ofxEditor::getText() {
+	string text;
 	if(m_selection != NONE) {
-		return wstring_to_string(m_text.substr(m_highlightStart, m_highlightEnd-m_highlightStart));
+		m_text.copy(text, m_highlightStart, m_highlightEnd-m_highlightStart);
+	}
+	else {
+		m_text.copy(text, 0);
 	}
-	return wstring_to_string(m_text);
+	return text;
 }
 
 //--------------------------------------------------------------
 void ofxEditor::setText(const std::u32string& text) {
-	if(m_text != U"") {
-		m_position = lineStart(m_position);
-		int line = getCurrentLine();
-		m_text = text;
-		setCurrentLine(line);
-	}
-	else {
-		m_text = text;
-	}
-	if(m_settings->getConvertTabs()) {
-		processTabs();
-	}
-	textBufferUpdated();
+	int line = textReplacing();
+	m_text = text;
+	textReplaced(line);
 }
 
 //--------------------------------------------------------------
 void ofxEditor::setText(const std::string& text) {
-	setText(string_to_wstring(text));
+	int line = textReplacing();
+	m_text.assign(text.data(), text.size());
+	textReplaced(line);
 }
 
 //--------------------------------------------------------------
@@ -1207,12 +1307,13 @@ void ofxEditor::insertText(const std::u32string& text) {
 			m_position -= m_highlightEnd-m_highlightStart;
 		}
 	}
-	m_text.insert(m_position, text);
+	
+	// only the inserted text needs converting
+	u32string expanded;
+	const u32string &inserted = (m_settings->getConvertTabs() && expandTabs(text, expanded)) ? expanded : text;
+	m_text.insert(m_position, inserted);
 	m_selection = NONE;
-	m_position += text.size();
-	if(m_settings->getConvertTabs()) {
-		processTabs();
-	}
+	m_position += inserted.size();
 	textBufferUpdated();
 }
 
@@ -1243,7 +1344,7 @@ void ofxEditor::deleteText(unsigned int numChars, bool forward) {
 
 //--------------------------------------------------------------
 void ofxEditor::clearText() {
-	m_text = U"";
+	m_text.clear();
 	if(m_colorScheme) {
 		clearTextBlocks();
 	}
@@ -1361,7 +1462,7 @@ void ofxEditor::setAutoFocus(bool focus) {
 	int visLines = 0;
 	size_t step = 0;
 	for(unsigned int i = m_topTextPosition;
-		i < m_bottomTextPosition && (step = m_text.find(L'\n', i)) != u32string::npos;
+		i < m_bottomTextPosition && (step = m_text.find('\n', i)) != ofxEditorBuffer::npos;
 		i = step+1) {
 		visLines++;
 	}
@@ -1387,7 +1488,7 @@ void ofxEditor::setAutoFocus(bool focus) {
 		
 		// count num lines from top to cursor
 		for(unsigned int i = m_topTextPosition;
-			i < m_position && (step = m_text.find('\n', i)) != u32string::npos;
+			i < m_position && (step = m_text.find('\n', i)) != ofxEditorBuffer::npos;
 			i = step+1) {
 			cursorLines++;
 		}
@@ -1474,23 +1575,15 @@ unsigned int ofxEditor::getCurrentLine() {
 
 //--------------------------------------------------------------
 void ofxEditor::setCurrentLine(unsigned int line) {
-	m_position = 0;
-	int count = 0;
-	for(unsigned int i = 0; count <= line && i < m_text.size(); i++) {
-		if(m_text[i] == '\n') {
-			count++;
-		}
-		if(count <= line) {
-			m_position++;
-		}
-	}
+	line = std::min(line, (unsigned int)m_text.getNumLineBreaks());
+	m_position = m_text.getLineEnd(line);
 	if(m_position < m_topTextPosition) {
 		m_topTextPosition = lineStart(m_position);
 	}
 	if(m_position >= m_bottomTextPosition) {
 		m_topTextPosition = lineEnd(m_topTextPosition)+1;
 	}
-	m_position = lineStart(m_position);
+	m_position = m_text.getLineStart(line);
 }
 
 //--------------------------------------------------------------
@@ -1527,25 +1620,17 @@ void ofxEditor::reset() {
 	
 //--------------------------------------------------------------
 void ofxEditor::undo() {
-	if(!s_undo || m_undoActions.empty()) {
+	if(!s_undo) {
 		return;
 	}
-	if(m_undoPos > -1) {
-		UndoAction &a = m_undoActions[m_undoPos];
-		setCurrentPos(a.pos);
-		switch(a.type) {
-			case ACTION_INSERT:
-				deleteText(a.insertText.size());
-				break;
-			case ACTION_REPLACE: case ACTION_OVERWRITE:
-				deleteText(a.insertText.size());
-				insertText(a.deleteText);
-				break;
-			case ACTION_DELETE: case ACTION_BACKSPACE:
-				insertText(a.deleteText);
-				break;
+	const ofxEditorUndo::Action *a = m_undo.undo();
+	if(a) {
+		u32string text;
+		m_undo.getDeleteText(*a, text);
+		applyUndo(a->pos, a->insertLength, text);
+		if(a->type == ACTION_DELETE || a->type == ACTION_INSERT) {
+			m_position = a->pos;
 		}
-		m_undoPos--;
 		#ifdef DEBUG_UNDO
 			printUndo();
 		#endif
@@ -1554,45 +1639,85 @@ void ofxEditor::undo() {
 
 //--------------------------------------------------------------
 void ofxEditor::redo() {
-	if(!s_undo || m_undoActions.empty()) {
+	if(!s_undo) {
 		return;
 	}
-	if(m_undoPos < (int)m_undoActions.size()-1) {
-		m_undoPos++;
-		UndoAction &a = m_undoActions[m_undoPos];
-		setCurrentPos(a.pos);
-		switch(a.type) {
-			case ACTION_INSERT:
-				insertText(a.insertText);
-				break;
-			case ACTION_REPLACE: case ACTION_OVERWRITE:
-				deleteText(a.deleteText.size());
-				insertText(a.insertText);
-				break;
-			case ACTION_DELETE:
-				deleteText(a.deleteText.size());
-			case ACTION_BACKSPACE:
-				deleteText(a.deleteText.size(), false);
-				break;
-		}
+	const ofxEditorUndo::Action *a = m_undo.redo();
+	if(a) {
+		u32string text;
+		m_undo.getInsertText(*a, text);
+		applyUndo(a->pos, a->deleteLength, text);
 		#ifdef DEBUG_UNDO
 			printUndo();
 		#endif
 	}
 }
 
+//--------------------------------------------------------------
+bool ofxEditor::switchRedoBranch(bool older) {
+	if(!s_undo) {
+		return false;
+	}
+	return m_undo.switchBranch(older);
+}
+
 //--------------------------------------------------------------
 void ofxEditor::clearUndo() {
 	if(!s_undo) {
 		return;
 	}
-	m_undoActions.clear();
-	m_undoPos = -1;
+	m_undo.clear();
 	#ifdef DEBUG_UNDO
 		printUndo();
 	#endif
 }
 
+// JOURNAL
+
+//--------------------------------------------------------------
+bool ofxEditor::openJournal(const std::string &path) {
+	closeJournal();
+	std::string journalPath = ofToDataPath(path);
+	if(ofFile::doesFileExist(journalPath, false)) {
+		if(!ofxEditorJournal::replay(journalPath, m_text, m_undo)) {
+			return false;
+		}
+
+		// back to the last edit
+		m_selection = NONE;
+		m_position = 0;
+		size_t current = m_undo.getCurrent();
+		if(current != ofxEditorUndo::npos && current >= m_undo.getFirst()) {
+			const ofxEditorUndo::Action &a = m_undo.get(current);
+			m_position = std::min(a.pos + a.insertLength, m_text.size());
+		}
+	}
+	m_journal.open(journalPath);
+	m_text.setJournal(&m_journal);
+	m_undo.setJournal(&m_journal);
+	textBufferUpdated(); // writes the first checkpoint
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxEditor::closeJournal(bool remove) {
+	if(!m_journal.isOpen()) {
+		return;
+	}
+	std::string path = m_journal.getPath();
+	m_text.setJournal(NULL);
+	m_undo.setJournal(NULL);
+	m_journal.close();
+	if(remove) {
+		ofFile::removeFile(path, false);
+	}
+}
+
+//--------------------------------------------------------------
+bool ofxEditor::isJournalOpen() {
+	return m_journal.isOpen();
+}
+
 // UTILS
 
 //--------------------------------------------------------------
@@ -1637,61 +1762,56 @@ float ofxEditor::drawString(u32string s, ofPoint& p) {
 //--------------------------------------------------------------
 void ofxEditor::printSyntax() {
 	if(!m_colorScheme) return;
-	for(list<TextBlock>::iterator iter = m_textBlocks.begin();
-		iter != m_textBlocks.end() && m_displayedLineCount < m_visibleLines; iter++) {
-		TextBlock &tb = (*iter);
-		string type;
-		switch(tb.type) {
-			case UNKNOWN:            type += "UNKNOWN"; break;
-			case WORD:               type += "WORD"; break;
-			case STRING_BEGIN:       ofLogNotice("ofxEditor") << "STRING_BEGIN"; continue;
-			case STRING_END:         ofLogNotice("ofxEditor") << "STRING_END"; continue;
-			case NUMBER:             type += "NUMBER"; break;
-			case SPACE:              type += "SPACE"; break;
-			case TAB:                type += "TAB"; break;
-			case ENDLINE:            ofLogNotice("ofxEditor") << "ENDLINE"; continue;
-			case MATCHING_CHAR:      type += "MATCHING_CHAR"; break;
-			case OPERATOR_CHAR:      type += "OPERATOR_CHAR"; break;
-			case PUNCTUATION_CHAR:   type += "PUNCTUATION_CHAR"; break;
-			case COMMENT_BEGIN:      ofLogNotice("ofxEditor") << "COMMENT_BEGIN"; continue;
-			case COMMENT_END:        ofLogNotice("ofxEditor") << "COMMENT_END"; continue;
-			case LITERAL_BEGIN:      ofLogNotice("ofxEditor") << "LITERAL_BEGIN"; continue;
-			case LITERAL_END:        ofLogNotice("ofxEditor") << "LITERAL_END"; continue;
-			case PREPROCESSOR_BEGIN: ofLogNotice("ofxEditor") << "PREPROCESSOR_BEGIN"; continue;
-			case PREPROCESSOR_END:   ofLogNotice("ofxEditor") << "PREPROCESSOR_END"; continue;
-		}
-		ofLogNotice("ofxEditor") << type << ": \"" << wstring_to_string(tb.text) << "\"";
+	parseTextLinesTo(m_textLines.size());
+	for(size_t line = 0; line < m_textLines.size(); ++line) {
+		unsigned int lineStart = m_text.getLineStart(line);
+		for(size_t block = 0; block < m_textLines[line].blocks.size(); ++block) {
+			TextBlock &tb = m_textLines[line].blocks[block];
+			string type;
+			switch(tb.type) {
+				case UNKNOWN:            type += "UNKNOWN"; break;
+				case WORD:               type += "WORD"; break;
+				case STRING_BEGIN:       ofLogNotice("ofxEditor") << "STRING_BEGIN"; continue;
+				case STRING_END:         ofLogNotice("ofxEditor") << "STRING_END"; continue;
+				case NUMBER:             type += "NUMBER"; break;
+				case SPACE:              type += "SPACE"; break;
+				case TAB:                type += "TAB"; break;
+				case ENDLINE:            ofLogNotice("ofxEditor") << "ENDLINE"; continue;
+				case MATCHING_CHAR:      type += "MATCHING_CHAR"; break;
+				case OPERATOR_CHAR:      type += "OPERATOR_CHAR"; break;
+				case PUNCTUATION_CHAR:   type += "PUNCTUATION_CHAR"; break;
+				case COMMENT_BEGIN:      ofLogNotice("ofxEditor") << "COMMENT_BEGIN"; continue;
+				case COMMENT_END:        ofLogNotice("ofxEditor") << "COMMENT_END"; continue;
+				case LITERAL_BEGIN:      ofLogNotice("ofxEditor") << "LITERAL_BEGIN"; continue;
+				case LITERAL_END:        ofLogNotice("ofxEditor") << "LITERAL_END"; continue;
+				case PREPROCESSOR_BEGIN: ofLogNotice("ofxEditor") << "PREPROCESSOR_BEGIN"; continue;
+				case PREPROCESSOR_END:   ofLogNotice("ofxEditor") << "PREPROCESSOR_END"; continue;
+			}
+			ofLogNotice("ofxEditor") << type << ": \"" << wstring_to_string(getBlockText(lineStart, tb)) << "\"";
+		}
 	}
 }
 
 void ofxEditor::printUndo() {
-	cout << endl << m_undoActions.size() << " undo actions" << endl;
-	for(int i = 0; i < m_undoActions.size(); ++i) {
-		cout << (i == m_undoPos ? "  * " : "    ");
-		UndoAction &a = m_undoActions[i];
-		switch(a.type) {
-			case ACTION_INSERT:
-				cout << "INSERT " << a.pos << " \"" << wstring_to_string(a.insertText) << "\"" << endl;
-				break;
-			case ACTION_REPLACE:
-				cout << "REPLACE " << a.pos
-				     << " \"" << wstring_to_string(a.insertText) << "\""
-					 << " \"" << wstring_to_string(a.deleteText) << "\""
-					 << endl;
-				break;
-			case ACTION_OVERWRITE:
-				cout << "OVERWRITE " << a.pos
-				     << " \"" << wstring_to_string(a.insertText) << "\""
-					 << " \"" << wstring_to_string(a.deleteText) << "\""
-					 << endl;
-				break;
-			case ACTION_DELETE:
-				cout << "DELETE " << a.pos << " \"" << wstring_to_string(a.deleteText) << "\"" << endl;
-				break;
-			case ACTION_BACKSPACE:
-				cout << "BACKSPACE " << a.pos << " \"" << wstring_to_string(a.deleteText) << "\"" << endl;
-				break;
+	static const char *types[] = {"INSERT", "REPLACE", "OVERWRITE", "BACKSPACE", "DELETE"};
+	cout << endl << m_undo.size() << " undo actions, " << m_undo.getNumBytes() << " bytes" << endl;
+	u32string insertText, deleteText;
+	for(size_t i = m_undo.getFirst(); i < m_undo.getFirst()+m_undo.size(); ++i) {
+		const ofxEditorUndo::Action &a = m_undo.get(i);
+		m_undo.getInsertText(a, insertText);
+		m_undo.getDeleteText(a, deleteText);
+		cout << (i == m_undo.getCurrent() ? "  * " : "    ") << i << " ";
+		if(a.parent != ofxEditorUndo::npos) {
+			cout << "<- " << a.parent << " ";
+		}
+		cout << types[a.type] << " " << a.pos;
+		if(a.insertLength > 0) {
+			cout << " +\"" << wstring_to_string(insertText) << "\"";
 		}
+		if(a.deleteLength > 0) {
+			cout << " -\"" << wstring_to_string(deleteText) << "\"";
+		}
+		cout << endl;
 	}
 	cout << endl;
 }
@@ -1798,12 +1918,48 @@ void ofxEditor::drawLineNumber(int &x, int &y, int &currentLine) {
 
 //--------------------------------------------------------------
 void ofxEditor::processTabs() {
-	size_t pos = m_text.find(U"\t", 0);
-	while(pos != string::npos) {
-		m_text.erase(pos, 1);
-		m_text.insert(pos, u32string(m_settings->getTabWidth(), ' '));
-		pos = m_text.find(U"\t", pos);
+	if(m_text.find('\t') == ofxEditorBuffer::npos) {
+		return;
 	}
+	u32string expanded;
+	expandTabs(m_text.getText(), expanded);
+	m_text.assign(expanded);
+}
+
+//--------------------------------------------------------------
+bool ofxEditor::expandTabs(const u32string &text, u32string &expanded) {
+	size_t tabs = std::count(text.begin(), text.end(), '\t');
+	if(tabs == 0) {
+		return false;
+	}
+	unsigned int width = m_settings->getTabWidth();
+	expanded.clear();
+	expanded.reserve(text.size() + tabs*(width-1));
+	for(size_t i = 0; i < text.size(); ++i) {
+		if(text[i] == '\t') {
+			expanded.append(width, ' ');
+		}
+		else {
+			expanded += text[i];
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+int ofxEditor::textReplacing() {
+	return m_text.empty() ? -1 : (int)getCurrentLine();
+}
+
+//--------------------------------------------------------------
+void ofxEditor::textReplaced(int line) {
+	if(line >= 0) {
+		setCurrentLine(line);
+	}
+	if(m_settings->getConvertTabs()) {
+		processTabs();
+	}
+	textBufferUpdated();
 }
 
 //--------------------------------------------------------------
@@ -1813,8 +1969,8 @@ int ofxEditor::offsetToCurrentLineStart() {
 
 //--------------------------------------------------------------
 int ofxEditor::nextLineLength(int pos) {
-	size_t nextLineStart = m_text.find(U"\n", pos);
-	if(nextLineStart != string::npos) {
+	size_t nextLineStart = m_text.find('\n', pos);
+	if(nextLineStart != ofxEditorBuffer::npos) {
 		return lineLength(nextLineStart+1);
 	}
 	return 0;
@@ -1822,11 +1978,11 @@ int ofxEditor::nextLineLength(int pos) {
 
 //--------------------------------------------------------------
 int ofxEditor::previousLineLength(int pos) {
-	size_t prevLineEnd = string::npos;
+	size_t prevLineEnd = ofxEditorBuffer::npos;
 	if(pos > 0) {
-		prevLineEnd = m_text.rfind(U"\n", pos-1);
+		prevLineEnd = m_text.rfind('\n', pos-1);
 	}
-	if(prevLineEnd != string::npos) {
+	if(prevLineEnd != ofxEditorBuffer::npos) {
 		return lineLength(prevLineEnd);
 	}
 	return 0;
@@ -1840,23 +1996,11 @@ int ofxEditor::lineLength(int pos) {
 
 //--------------------------------------------------------------
 unsigned int ofxEditor::lineStart(int pos) {
-	size_t start = string::npos;
-	if(pos > 0) {
-		// take one off if we're over a newline
-		if(m_text[pos] == '\n') {
-			start = m_text.rfind(U"\n", pos-1);
-		}
-		else {
-			start = m_text.rfind(U"\n", pos);
-		}
-	}
-	if(start != string::npos) {
-		start++; // move the start off the newline
-	}
-	else {
-		start = 0; // if are on the first line, set the start to 0
+	if(pos <= 0) {
+		return 0; // if are on the first line, set the start to 0
 	}
-	return start;
+	// a newline belongs to the line it ends
+	return m_text.getLineStart(m_text.getLineForPos(pos));
 }
 
 //--------------------------------------------------------------
@@ -1864,8 +2008,8 @@ unsigned int ofxEditor::lineEnd(int pos) {
 	if(m_text.empty()) {
 		return 0;
 	}
-	size_t end = m_text.find(U"\n", pos);
-	if(end == string::npos) {
+	size_t end = m_text.getLineEnd(m_text.getLineForPos(std::max(pos, 0)));
+	if(end == m_text.size()) { // no newline on the last line
 		end = m_text.size()-1;
 	}
 	return end;
@@ -1876,6 +2020,66 @@ void ofxEditor::parseMatchingChars() {
 
 	u32string &openChars = m_settings->getWideOpenChars();
 	u32string &closeChars = m_settings->getWideCloseChars();
+	
+	// use the bracket index from the syntax parser when highlighting,
+	// otherwise scan the text
+	if(m_colorScheme) {
+		updateTextBlocks();
+		if(m_matchingChars.valid && m_matchingChars.pos == m_position &&
+		   m_matchingChars.revision == m_text.getRevision() &&
+		   m_matchingChars.parsed == m_textLinesParsed &&
+		   m_matchingChars.syntax == m_syntax) {
+			m_matchingCharsHighlight[0] = m_matchingChars.highlight[0];
+			m_matchingCharsHighlight[1] = m_matchingChars.highlight[1];
+			return;
+		}
+		
+		// open char at the cursor, wait for the background parser instead of
+		// parsing up to a far away line
+		size_t line = m_text.getLineForPos(m_position);
+		unsigned int lineStart = m_text.getLineStart(line);
+		updateHighlighter();
+		if(line > m_textLinesParsed + HIGHLIGHT_SYNC_LINES) {
+			return;
+		}
+		parseTextLinesTo(line);
+		int index = findBracket(line, m_position - lineStart);
+		if(index > -1) {
+			size_t type = openChars.find(m_textLines[line].brackets[index].c);
+			if(type != u32string::npos) {
+				int match = matchOpenBracket(line, index, type);
+				if(match > -1) {
+					m_matchingCharsHighlight[0] = m_position;
+					m_matchingCharsHighlight[1] = match;
+				}
+			}
+		}
+		
+		// close char before the cursor, never on the previous line as that
+		// would be the line break
+		if(m_position > lineStart) {
+			index = findBracket(line, m_position - 1 - lineStart);
+			if(index > -1) {
+				size_t type = closeChars.find(m_textLines[line].brackets[index].c);
+				if(type != u32string::npos) {
+					int match = matchCloseBracket(line, index, type);
+					if(match > -1) {
+						m_matchingCharsHighlight[0] = match;
+						m_matchingCharsHighlight[1] = m_position - 1;
+					}
+				}
+			}
+		}
+		
+		m_matchingChars.valid = true;
+		m_matchingChars.pos = m_position;
+		m_matchingChars.revision = m_text.getRevision();
+		m_matchingChars.parsed = m_textLinesParsed;
+		m_matchingChars.syntax = m_syntax;
+		m_matchingChars.highlight[0] = m_matchingCharsHighlight[0];
+		m_matchingChars.highlight[1] = m_matchingCharsHighlight[1];
+		return;
+	}
 
 	// parse the parentheses
 	int type = 0;
@@ -1946,14 +2150,97 @@ void ofxEditor::parseCloseChars(int pos, int type) {
 }
 
 //--------------------------------------------------------------
-unsigned int ofxEditor::lineNumberForPos(unsigned int pos) {
-	int ret = 0;
-	for(unsigned int i = 0; i < pos; i++) {
-		if(m_text[i] == '\n') {
-			ret++;
+int ofxEditor::findBracket(size_t line, unsigned int offset) {
+	if(line >= m_textLines.size()) {
+		return -1;
+	}
+	vector<Bracket> &brackets = m_textLines[line].brackets;
+	int lo = 0, hi = (int)brackets.size()-1;
+	while(lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if(brackets[mid].offset < offset) {
+			lo = mid + 1;
+		}
+		else if(brackets[mid].offset > offset) {
+			hi = mid - 1;
+		}
+		else {
+			return mid;
+		}
+	}
+	return -1;
+}
+
+//--------------------------------------------------------------
+int ofxEditor::matchOpenBracket(size_t line, int index, int type) {
+
+	char32_t open = m_settings->getWideOpenChars()[type];
+	char32_t close = m_settings->getWideCloseChars()[type];
+
+	// looking for a close, so search forward, parsing pending lines near the
+	// parsed lines on the way, farther lines aren't known until the
+	// background parser or drawing gets to them
+	int stack = 0;
+	index++;
+	size_t end = std::min(m_textLines.size(), line + MATCHING_CHAR_LINES);
+	size_t syncEnd = m_textLinesParsed + HIGHLIGHT_SYNC_LINES;
+	for(; line < end; ++line) {
+		if(line > syncEnd) {
+			return -1;
+		}
+		parseTextLinesTo(line);
+		vector<Bracket> &brackets = m_textLines[line].brackets;
+		for(; index < (int)brackets.size(); ++index) {
+			if(brackets[index].c == open) {
+				stack++;
+			}
+			else if(brackets[index].c == close) {
+				if(stack == 0) {
+					return m_text.getLineStart(line) + brackets[index].offset;
+				}
+				stack--;
+			}
+		}
+		index = 0;
+	}
+	return -1;
+}
+
+//--------------------------------------------------------------
+int ofxEditor::matchCloseBracket(size_t line, int index, int type) {
+
+	char32_t open = m_settings->getWideOpenChars()[type];
+	char32_t close = m_settings->getWideCloseChars()[type];
+
+	// looking for an open, so search backward, preceding lines are parsed
+	int stack = 0;
+	index--;
+	size_t end = (line > MATCHING_CHAR_LINES ? line - MATCHING_CHAR_LINES : 0);
+	while(true) {
+		vector<Bracket> &brackets = m_textLines[line].brackets;
+		for(; index >= 0; --index) {
+			if(brackets[index].c == close) {
+				stack++;
+			}
+			else if(brackets[index].c == open) {
+				if(stack == 0) {
+					return m_text.getLineStart(line) + brackets[index].offset;
+				}
+				stack--;
+			}
+		}
+		if(line == end) {
+			break;
 		}
+		line--;
+		index = (int)m_textLines[line].brackets.size()-1;
 	}
-	return ret;
+	return -1;
+}
+
+//--------------------------------------------------------------
+unsigned int ofxEditor::lineNumberForPos(unsigned int pos) {
+	return m_text.getLineForPos(pos);
 }
 
 //--------------------------------------------------------------
@@ -1997,7 +2284,7 @@ void ofxEditor::pasteSelection() {
 				updateUndo(ACTION_REPLACE, m_highlightStart, s_copyBuffer, m_text.substr(m_highlightStart, m_highlightEnd-m_highlightStart));
 			}
 			else {
-				updateUndo(ACTION_INSERT, m_position, s_copyBuffer, L"");
+				updateUndo(ACTION_INSERT, m_position, s_copyBuffer, U"");
 			}
 		}
 		insertText(s_copyBuffer);
@@ -2041,12 +2328,17 @@ void ofxEditor::clearBoundingBox() {
 //--------------------------------------------------------------
 void ofxEditor::textBufferUpdated() {
 	
-	if(m_colorScheme) {
-		parseTextBlocks();
+	// line breaks are indexed by the buffer
+	m_numLines = m_text.getNumLineBreaks();
+
+	// start a new journal when the text was replaced, the old one is large,
+	// or the last write failed
+	if(m_journal.needsCheckpoint()) {
+		m_journal.checkpoint(m_text, m_undo);
 	}
-	else {
-		// compute number of lines
-		m_numLines = count(m_text.begin(), m_text.end(), '\n');
+
+	if(m_colorScheme) {
+		updateTextBlocks();
 	}
 	
 	// adjust max screen width for line numbers
@@ -2075,185 +2367,462 @@ void ofxEditor::updateVisibleSize() {
 
 //--------------------------------------------------------------
 void ofxEditor::updateUndo(UndoActionType type, unsigned int pos, const u32string &insertText, const u32string &deleteText) {
+	long now = ofGetElapsedTimeMillis();
 	
-	// add if empty
-	if(m_undoActions.empty()) {
-		UndoAction a;
-		a.type = type;
-		a.pos = pos;
-		m_undoActions.push_back(a);
-		m_undoPos = 0;
-	}
-	else {
-		
-		// clear if all actions have been redone
-		if(m_undoPos < 0) {
-			m_undoActions.clear();
+	// extend the current action with contiguous input of the same type until
+	// timeout, typing after an overwrite extends it too
+	ofxEditorUndo::Action *action = m_undo.getExtendable();
+	if(action && now - action->timestamp <= UNDO_TIMEOUT) {
+		bool extended = true;
+		if(type == ACTION_INSERT && deleteText.empty() &&
+		   (action->type == ACTION_INSERT || action->type == ACTION_OVERWRITE) &&
+		   pos == action->pos + action->insertLength) {
+			m_undo.appendInsertText(insertText);
+		}
+		else if(type == ACTION_DELETE && insertText.empty() &&
+		        action->type == ACTION_DELETE && pos == action->pos) {
+			m_undo.appendDeleteText(deleteText);
+		}
+		else if(type == ACTION_BACKSPACE && insertText.empty() &&
+		        action->type == ACTION_BACKSPACE && pos + deleteText.size() == action->pos) {
+			m_undo.prependDeleteText(deleteText, pos);
 		}
 		else {
-		
-			// pop oldest entries if at max depth
-			if(m_undoActions.size() > s_undoMaxDepth) {
-				int num = m_undoActions.size()-s_undoMaxDepth;
-				int end = m_undoActions.size()-1;
-				for(int i = 0; i < num; ++i) {
-					m_undoActions.erase(m_undoActions.begin()); // pop front
-					end--;
-					if(m_undoPos > end) { // keep pos at end
-						m_undoPos = end;
-					}
-				}
-			}
-			
-			// pop newest actions for new entries
-			if(m_undoPos < m_undoActions.size()-1) {
-				for(int i = m_undoActions.size()-1; i > m_undoPos; --i) {
-					m_undoActions.pop_back();
-				}
+			extended = false;
+		}
+		if(extended) {
+			action->timestamp = now;
+			#ifdef DEBUG_UNDO
+				printUndo();
+			#endif
+			return;
+		}
+	}
+	
+	// new action, pop the oldest ones if over budget
+	m_undo.add(type, pos, insertText, deleteText, now);
+	m_undo.trim(s_undoMaxBytes, s_undoMaxDepth);
+	
+#ifdef DEBUG_UNDO
+	printUndo();
+#endif
+}
+
+//--------------------------------------------------------------
+void ofxEditor::applyUndo(unsigned int pos, size_t length, const u32string &text) {
+	pos = std::min(pos, (unsigned int)m_text.size());
+	m_selection = NONE;
+	m_text.erase(pos, length);
+	m_text.insert(pos, text);
+	m_position = pos + text.size();
+	textBufferUpdated();
+}
+
+// PRIVATE
+
+//--------------------------------------------------------------
+// simple syntax parser
+void ofxEditor::parseTextBlocks() {
+	m_textLines.resize(m_text.getNumLineBreaks()+1);
+	m_textLines[0].state = ParserState();
+	m_textLinesParsed = 0;
+	m_textLinesSyntax = m_syntax;
+	m_textLinesSyntaxRevision = (m_syntax ? m_syntax->getRevision() : 0);
+	m_lineParser.setMatchingChars(m_settings->getWideOpenChars(), m_settings->getWideCloseChars());
+	m_matchingChars.valid = false;
+	m_text.clearChanges();
+	
+	// only parse what's visible, the rest is parsed when drawn, visible lines
+	// far from the start are drawn plain until the background parser is done
+	size_t line = m_text.getLineForPos(m_topTextPosition);
+	if(line <= HIGHLIGHT_SYNC_LINES) {
+		parseTextLinesTo(line + m_visibleLines);
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditor::updateTextBlocks() {
+	size_t first, last;
+	long delta;
+	if(m_textLines.empty() || m_textLinesSyntax != m_syntax ||
+	   (m_syntax && m_syntax->getRevision() != m_textLinesSyntaxRevision)) {
+		parseTextBlocks(); // nothing to update or the syntax changed
+		return;
+	}
+	m_lineParser.setMatchingChars(m_settings->getWideOpenChars(), m_settings->getWideCloseChars());
+	if(!m_text.getChangedLines(first, last, delta)) {
+		return;
+	}
+	
+	// changed lines replace the old lines [first, last-delta], keep the first
+	// line as it's start state is still valid
+	size_t oldLast = last - delta;
+	if(oldLast >= m_textLines.size()) {
+		parseTextBlocks(); // out of sync
+		return;
+	}
+	if(delta > 0) {
+		m_textLines.insert(m_textLines.begin()+oldLast+1, delta, TextLine());
+	}
+	else if(delta < 0) {
+		m_textLines.erase(m_textLines.begin()+last+1, m_textLines.begin()+oldLast+1);
+	}
+	if(delta != 0) {
+		for(size_t i = 0; i < m_cachedLines.size(); ++i) {
+			if(m_cachedLines[i] > oldLast) {
+				m_cachedLines[i] += delta; // moved with the following lines
 			}
 		}
 	}
+	m_text.clearChanges();
 	
-	UndoAction *action = &m_undoActions[m_undoPos];
+	// changes past the parsed lines are parsed when drawn
+	if(first >= m_textLinesParsed) {
+		return;
+	}
 	
-	// add new entry if timeout reached, after a replace, or on new type ...
-	// .., except overwrites append insert text until timeout
-	if((ofGetElapsedTimeMillis() - action->timestamp > UNDO_TIMEOUT) ||
-		((action->type == ACTION_REPLACE) ||
-		 ((type != ACTION_INSERT && action->type != ACTION_OVERWRITE) &&
-		 (action->type != type)))) {
-		UndoAction a;
-		a.type = type;
-		a.pos = pos;
-		m_undoActions.push_back(a);
-		m_undoPos++;
-		action = &m_undoActions[m_undoPos];
+	// parsed lines following the changes
+	size_t parsedEnd = last+1;
+	if(m_textLinesParsed > oldLast+1) {
+		parsedEnd = m_textLinesParsed + delta;
 	}
 	
-	switch(type) {
-		case ACTION_INSERT:
-			action->insertText += insertText;
-			break;
-		case ACTION_REPLACE:
-			action->insertText = insertText;
-			action->deleteText = deleteText;
-			break;
-		case ACTION_OVERWRITE:
-			action->insertText = insertText;
-			action->deleteText = deleteText;
+	// reparse changed lines & continue until the state at the start of a
+	// following parsed line matches the cached state, stop early once past
+	// the visible lines or HIGHLIGHT_SYNC_LINES & leave the rest to be parsed
+	// when drawn or by the background parser
+	size_t visibleEnd = std::min(lastVisibleLine(), first + HIGHLIGHT_SYNC_LINES);
+	for(size_t line = first; line < m_textLines.size(); ++line) {
+		ParserState state = parseTextLine(line);
+		m_textLinesParsed = line+1;
+		if(line+1 >= m_textLines.size()) {
 			break;
-		case ACTION_DELETE:
-			action->deleteText += deleteText;
+		}
+		if(line >= last && line+1 < parsedEnd && m_textLines[line+1].state == state) {
+			m_textLinesParsed = parsedEnd; // converged
 			break;
-		case ACTION_BACKSPACE:
-			action->deleteText = deleteText + action->deleteText;
+		}
+		m_textLines[line+1].state = state;
+		if(line >= visibleEnd) {
 			break;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditor::parseTextLinesTo(size_t line) {
+	for(; m_textLinesParsed <= line && m_textLinesParsed < m_textLines.size(); m_textLinesParsed++) {
+		ParserState state = parseTextLine(m_textLinesParsed);
+		if(m_textLinesParsed+1 < m_textLines.size()) {
+			m_textLines[m_textLinesParsed+1].state = state;
+		}
 	}
-	action->timestamp = ofGetElapsedTimeMillis();
+}
+
+//--------------------------------------------------------------
+size_t ofxEditor::lastVisibleLine() {
+	return m_text.getLineForPos(m_topTextPosition) + m_visibleLines;
+}
+
+//--------------------------------------------------------------
+ofxEditor::ParserState ofxEditor::parseTextLine(size_t line) {
 	
-#ifdef DEBUG_UNDO
-	printUndo();
-#endif
+	// parse through the line break, if any, from a flat copy of the line
+	TextLine &textLine = m_textLines[line];
+	size_t start = m_text.getLineStart(line);
+	size_t end = std::min(m_text.getLineEnd(line)+1, m_text.size());
+	m_lineText.clear();
+	m_text.copy(m_lineText, start, end-start);
+	textLine.cache.revision = 0;
+	
+	m_lineParser.setSyntax(m_syntax);
+	return m_lineParser.parse(m_lineText.data(), m_lineText.size(),
+		textLine.state, textLine.blocks, textLine.brackets);
 }
 
-// PRIVATE
+//--------------------------------------------------------------
+void ofxEditor::parsePlainTextLines(size_t first, size_t last) {
+	last = std::min(last, m_textLines.size()-1);
+	m_lineParser.setSyntax(NULL);
+	for(size_t line = std::max(first, m_textLinesParsed); line <= last; ++line) {
+		TextLine &textLine = m_textLines[line];
+		size_t start = m_text.getLineStart(line);
+		size_t end = std::min(m_text.getLineEnd(line)+1, m_text.size());
+		m_lineText.clear();
+		m_text.copy(m_lineText, start, end-start);
+		textLine.cache.revision = 0;
+		m_lineParser.parse(m_lineText.data(), m_lineText.size(),
+			ParserState(), textLine.blocks, textLine.brackets);
+	}
+}
+
+// BACKGROUND PARSING
 
 //--------------------------------------------------------------
-// simple syntax parser
-void ofxEditor::parseTextBlocks() {
+void ofxEditor::updateHighlighter() {
 	
-	clearTextBlocks();
-	m_numLines = 0;
+	// results ready? use them if the text & syntax haven't changed since
+	// starting, lines parsed on the main thread since then are the same
+	if(m_highlighter && m_highlighter->done) {
+		Highlighter *h = m_highlighter;
+		h->thread.join();
+		size_t end = h->first + h->lines.size();
+		if(h->revision == m_text.getRevision() && h->syntax == m_textLinesSyntax &&
+		   h->syntaxRevision == m_textLinesSyntaxRevision &&
+		   h->first <= m_textLinesParsed && end <= m_textLines.size()) {
+			for(size_t line = m_textLinesParsed; line < end; ++line) {
+				std::swap(m_textLines[line], h->lines[line - h->first]);
+			}
+			if(end < m_textLines.size()) {
+				m_textLines[end].state = h->endState;
+			}
+			m_textLinesParsed = std::max(m_textLinesParsed, end);
+			m_matchingChars.valid = false;
+		}
+		delete h;
+		m_highlighter = NULL;
+	}
+	
+	// stale? stop it, a new one is started once edits pause
+	if(m_highlighter && (m_highlighter->revision != m_text.getRevision() ||
+	   m_highlighter->syntax != m_textLinesSyntax ||
+	   m_highlighter->syntaxRevision != m_textLinesSyntaxRevision)) {
+		stopHighlighter();
+	}
+	
+	if(!m_highlighter && m_textLinesSyntax == m_syntax &&
+	   m_highlighterRevision == m_text.getRevision() &&
+	   m_textLinesParsed + HIGHLIGHT_THREAD_LINES < m_textLines.size()) {
+		startHighlighter();
+	}
+	m_highlighterRevision = m_text.getRevision();
+}
+
+//--------------------------------------------------------------
+void ofxEditor::startHighlighter() {
+	stopHighlighter();
+	Highlighter *h = new Highlighter;
+	h->revision = m_text.getRevision();
+	h->syntax = m_textLinesSyntax;
+	h->syntaxRevision = m_textLinesSyntaxRevision;
+	h->first = m_textLinesParsed;
+	h->start = m_text.getLineStart(h->first);
+	h->state = m_textLines[h->first].state;
+	h->text = m_text.snapshot();
+	if(m_syntax) {
+		h->syntaxCopy = *m_syntax;
+		h->parser.setSyntax(&h->syntaxCopy);
+	}
+	h->parser.setMatchingChars(m_settings->getWideOpenChars(), m_settings->getWideCloseChars());
+	h->lines.reserve(m_textLines.size() - h->first);
+	h->thread = std::thread(&Highlighter::run, h);
+	m_highlighter = h;
+}
+
+//--------------------------------------------------------------
+void ofxEditor::stopHighlighter() {
+	if(!m_highlighter) {
+		return;
+	}
+	m_highlighter->cancel = true;
+	m_highlighter->thread.join();
+	delete m_highlighter;
+	m_highlighter = NULL;
+}
+
+//--------------------------------------------------------------
+bool ofxEditor::isHighlighterRunning() {
+	return m_highlighter != NULL;
+}
+
+//--------------------------------------------------------------
+void ofxEditor::Highlighter::run() {
+	ParserState lineState = state;
+	auto parseLine = [this, &lineState](const char32_t *text, size_t length) {
+		lines.push_back(TextLine());
+		TextLine &line = lines.back();
+		line.state = lineState;
+		lineState = parser.parse(text, length, lineState, line.blocks, line.brackets);
+	};
+	
+	// lines within a snapshot chunk are parsed in place, lines spanning
+	// chunks are joined first
+	u32string joined;
+	auto parseChunk = [this, &parseLine, &joined](const char32_t *chunk, size_t n, size_t /*chunkPos*/) {
+		size_t start = 0;
+		while(start < n) {
+			if(cancel) {
+				return false;
+			}
+			const char32_t *found = std::char_traits<char32_t>::find(chunk+start, n-start, '\n');
+			if(!found) {
+				joined.append(chunk+start, n-start);
+				break;
+			}
+			size_t end = (found-chunk)+1; // include break
+			if(joined.empty()) {
+				parseLine(chunk+start, end-start);
+			}
+			else {
+				joined.append(chunk+start, end-start);
+				parseLine(joined.data(), joined.size());
+				joined.clear();
+			}
+			start = end;
+		}
+		return true;
+	};
+	text.visit(start, ofxEditorBuffer::npos, parseChunk);
+	
+	// the last line, empty when the text ends with a line break
+	if(!cancel) {
+		parseLine(joined.data(), joined.size());
+	}
+	endState = lineState;
+	done = true;
+}
+
+// LINE PARSER
+
+//--------------------------------------------------------------
+ofxEditor::LineParser::LineParser() {
+	m_syntax = NULL;
+	m_line = NULL;
+	m_lineLength = 0;
+	std::fill(m_matchingCharTable, m_matchingCharTable+256, false);
+}
+
+//--------------------------------------------------------------
+void ofxEditor::LineParser::setSyntax(ofxEditorSyntax *syntax) {
+	m_syntax = syntax;
+}
+
+//--------------------------------------------------------------
+void ofxEditor::LineParser::setMatchingChars(const u32string &openChars, const u32string &closeChars) {
+	if(openChars == m_openChars && closeChars == m_closeChars) {
+		return;
+	}
+	std::fill(m_matchingCharTable, m_matchingCharTable+256, false);
+	for(size_t i = 0; i < openChars.size(); ++i) {
+		if(openChars[i] < 256) {
+			m_matchingCharTable[openChars[i]] = true;
+		}
+	}
+	for(size_t i = 0; i < closeChars.size(); ++i) {
+		if(closeChars[i] < 256) {
+			m_matchingCharTable[closeChars[i]] = true;
+		}
+	}
+	m_openChars = openChars;
+	m_closeChars = closeChars;
+}
+
+//--------------------------------------------------------------
+ofxEditor::ParserState ofxEditor::LineParser::parse(const char32_t *text, size_t length,
+	const ParserState &lineState, vector<TextBlock> &blocks, vector<Bracket> &brackets) {
+	
+	blocks.clear();
+	brackets.clear();
+	m_line = text;
+	m_lineLength = length;
 	
-	int string = false;
+	int string = lineState.string;
 	bool preprocessor = false;
 	bool singleComment = false;
-	bool multiComment = false;
-	bool stringLiteral = false;
+	bool multiComment = lineState.multiComment;
+	bool stringLiteral = lineState.stringLiteral;
+	
+	// char class flags, delimiter & char checks are only made for chars
+	// which could match
+	const unsigned char *classes = (m_syntax ? m_syntax->getCharClasses() : NULL);
 	
 	TextBlock tb;
-	for(int i = 0; i < m_text.length(); ++i) {
+	for(unsigned int offset = 0; offset < length; ++offset) {
 		
-		switch(m_text[i]) {
+		char32_t c = text[offset];
+		unsigned int charClass = ofxEditorSyntax::CLASS_NONE;
+		if(m_syntax) {
+			charClass = (c < 256 ? classes[c] : m_syntax->getCharClass(c));
+		}
+		switch(c) {
 		
 			case ' ':
 				if(tb.type != UNKNOWN) {
-					m_textBlocks.push_back(tb);
+					blocks.push_back(tb);
 					tb.clear();
 				}
 				tb.type = SPACE;
-				tb.text = m_text[i];
-				m_textBlocks.push_back(tb);
+				tb.set(offset);
+				blocks.push_back(tb);
 				tb.clear();
 				break;
 		
 			case '\n':
-				m_numLines++; // compute number of lines while parsing
 				if(tb.type != UNKNOWN) {
-					m_textBlocks.push_back(tb);
+					blocks.push_back(tb);
 					tb.clear();
 				}
 				if(preprocessor) {
-					m_textBlocks.push_back(TextBlock(PREPROCESSOR_END));
+					blocks.push_back(TextBlock(PREPROCESSOR_END));
 					preprocessor = false;
 				}
 				if(singleComment) {
-					m_textBlocks.push_back(TextBlock(COMMENT_END));
+					blocks.push_back(TextBlock(COMMENT_END));
 					singleComment = false;
 				}
 				tb.type = ENDLINE;
-				tb.text = m_text[i];
-				m_textBlocks.push_back(tb);
+				tb.set(offset);
+				blocks.push_back(tb);
 				tb.clear();
 				break;
 				
 			case '\t':
 				if(tb.type != UNKNOWN) {
-					m_textBlocks.push_back(tb);
+					blocks.push_back(tb);
 					tb.clear();
 				}
 				tb.type = TAB;
-				tb.text = m_text[i];
-				m_textBlocks.push_back(tb);
+				tb.set(offset);
+				blocks.push_back(tb);
 				tb.clear();
 				break;
 				
 			case '"': case '\'':
 				if(singleComment || multiComment || stringLiteral) { // ignore strings in comments
-					tb.text += m_text[i];
+					tb.append(offset);
 					break;
 				}
-				if(string == m_text[i]) { // same as the opening string char?
+				if(string == c) { // same as the opening string char?
 				
 					// don't terminate an escaping slash
-					if(tb.text.length() > 0 && tb.text[tb.text.size()-1] == '\\') {
-						tb.text += m_text[i];
+					if(tb.length > 0 && text[tb.offset+tb.length-1] == '\\') {
+						tb.append(offset);
 						break;
 					}
 
 					if(tb.type == UNKNOWN) {
 						tb.type = WORD;
 					}
-					tb.text += m_text[i];
-					m_textBlocks.push_back(tb);
+					tb.append(offset);
+					blocks.push_back(tb);
 					tb.clear();
-					m_textBlocks.push_back(TextBlock(STRING_END));
+					blocks.push_back(TextBlock(STRING_END));
 					string = false;
 				}
 				else if(string) { // wrong char, keep going
-					tb.text += m_text[i];
+					tb.append(offset);
 				}
 				else { // opening string char
 					if(tb.type != UNKNOWN) {
-						m_textBlocks.push_back(tb);
+						blocks.push_back(tb);
 						tb.clear();
 					}
 					if(tb.type == UNKNOWN) {
 						tb.type = WORD;
 					}
-					tb.text += m_text[i];
-					m_textBlocks.push_back(TextBlock(STRING_BEGIN));
-					string = m_text[i];
+					tb.append(offset);
+					blocks.push_back(TextBlock(STRING_BEGIN));
+					string = c;
 				}
 				break;
 				
@@ -2261,30 +2830,30 @@ void ofxEditor::parseTextBlocks() {
 			case '5': case '6': case '7': case '8': case '9':
 				if(tb.type != UNKNOWN) {
 					if(string) {
-						tb.text += m_text[i];
+						tb.append(offset);
 						break;
 					}
 					else if(tb.type == WORD) {
 						// detect words after punctuation aka (, [, etc
-						if(i > 0 && ispunct(m_text[i-1]) ) {
-							m_textBlocks.push_back(tb);
+						if(offset > 0 && ispunct(text[offset-1]) ) {
+							blocks.push_back(tb);
 							tb.clear();
 						}
 					}
 					else if(tb.type != NUMBER) {
-						m_textBlocks.push_back(tb);
+						blocks.push_back(tb);
 						tb.clear();
 					}
 				}
 				if(tb.type != WORD) {
 					tb.type = NUMBER;
 				}
-				tb.text += m_text[i];
+				tb.append(offset);
 				break;
 		
 			case '.': // could be number decimal point
 				if(tb.type == NUMBER) {
-					tb.text += m_text[i];
+					tb.append(offset);
 					break;
 				}
 		
@@ -2294,24 +2863,23 @@ void ofxEditor::parseTextBlocks() {
 						// catch hex literal aka 0x001F
 						if(m_syntax && m_syntax->getHexLiteral()) {
 							// started?
-							if((tb.text.substr(0, 2) == U"0x") &&
-							   ((m_text[i] >= 'a' && m_text[i] <= 'f') ||
-							   (m_text[i] >= 'A' && m_text[i] <= 'F'))) {
-								tb.text += m_text[i];
+							if((tb.length >= 2 && text[tb.offset] == '0' && text[tb.offset+1] == 'x') &&
+							   ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+								tb.append(offset);
 								break;
 							}
 							// starting?
-							if(tb.text.size() == 1 && tb.text[0] == '0' && m_text[i] == 'x') {
-								tb.text += m_text[i];
+							if(tb.length == 1 && text[tb.offset] == '0' && c == 'x') {
+								tb.append(offset);
 								break;
 							}
 						}
-						m_textBlocks.push_back(tb);
+						blocks.push_back(tb);
 						tb.clear();
 					case UNKNOWN:
 						tb.type = WORD;
 					case WORD:
-						tb.text += m_text[i];
+						tb.append(offset);
 						
 						// in a string, so everything is a word, number, or whitespace
 						if(string) {
@@ -2322,17 +2890,18 @@ void ofxEditor::parseTextBlocks() {
 						if(!m_syntax) {
 						
 							// check for open/close characters
-							if(m_settings->getWideOpenChars().find(m_text[i], 0) != u32string::npos ||
-							   m_settings->getWideCloseChars().find(m_text[i], 0) != u32string::npos) {
-								if(tb.type != UNKNOWN && tb.text.length() > 1) {
-									tb.text = tb.text.substr(0, tb.text.length()-1);
-									m_textBlocks.push_back(tb);
+							if(isMatchingChar(c)) {
+								if(tb.type != UNKNOWN && tb.length > 1) {
+									tb.length--; // remove current char
+									blocks.push_back(tb);
 									tb.clear();
 								}
 								tb.type = MATCHING_CHAR;
-								tb.text = m_text[i];
-								m_textBlocks.push_back(tb);
+								tb.set(offset);
+								blocks.push_back(tb);
 								tb.clear();
+								Bracket bracket = {offset, c};
+								brackets.push_back(bracket);
 							}
 							break;
 						}
@@ -2341,23 +2910,23 @@ void ofxEditor::parseTextBlocks() {
 						if(!multiComment && !stringLiteral) {
 						
 							// check ahead for string literal begin
-							if(i <= m_text.size()-m_syntax->getWideStringLiteralBegin().length() &&
-							   m_text.substr(i, m_syntax->getWideStringLiteralBegin().length()) == m_syntax->getWideStringLiteralBegin()) {
+							if((charClass & ofxEditorSyntax::CLASS_LITERAL_BEGIN) &&
+							   matches(offset, m_syntax->getWideStringLiteralBegin())) {
 								if(stringLiteral) { // already pushed string literal begin
 									stringLiteral = false;
 								}
 								else {
 									if(preprocessor) {
-										m_textBlocks.push_back(TextBlock(PREPROCESSOR_END));
+										blocks.push_back(TextBlock(PREPROCESSOR_END));
 										preprocessor = false;
 									}
-									m_textBlocks.push_back(TextBlock(LITERAL_BEGIN));
+									blocks.push_back(TextBlock(LITERAL_BEGIN));
 								}
 								stringLiteral = true;
 								continue;
 							}
-							else if(i <= m_text.size()-m_syntax->getWideMultiLineCommentBegin().length() &&
-							   m_text.substr(i, m_syntax->getWideMultiLineCommentBegin().length()) == m_syntax->getWideMultiLineCommentBegin()) {
+							else if((charClass & ofxEditorSyntax::CLASS_COMMENT_BEGIN) &&
+							        matches(offset, m_syntax->getWideMultiLineCommentBegin())) {
 								
 								// check ahead for multi line comment begin
 								if(singleComment) { // already pushed comment begin
@@ -2365,10 +2934,10 @@ void ofxEditor::parseTextBlocks() {
 								}
 								else {
 									if(preprocessor) {
-										m_textBlocks.push_back(TextBlock(PREPROCESSOR_END));
+										blocks.push_back(TextBlock(PREPROCESSOR_END));
 										preprocessor = false;
 									}
-									m_textBlocks.push_back(TextBlock(COMMENT_BEGIN));
+									blocks.push_back(TextBlock(COMMENT_BEGIN));
 								}
 								multiComment = true;
 								continue;
@@ -2376,13 +2945,13 @@ void ofxEditor::parseTextBlocks() {
 							else if(!singleComment && !m_syntax->getWideSingleLineComment().empty()) {
 							
 								// check ahead for single line comment
-								if(i <= m_text.size()-m_syntax->getWideSingleLineComment().length() &&
-								   m_text.substr(i, m_syntax->getWideSingleLineComment().length()) == m_syntax->getWideSingleLineComment()) {
+								if((charClass & ofxEditorSyntax::CLASS_SINGLE_COMMENT) &&
+								   matches(offset, m_syntax->getWideSingleLineComment())) {
 									if(preprocessor) {
-										m_textBlocks.push_back(TextBlock(PREPROCESSOR_END));
+										blocks.push_back(TextBlock(PREPROCESSOR_END));
 										preprocessor = false;
 									}
-									m_textBlocks.push_back(TextBlock(COMMENT_BEGIN));
+									blocks.push_back(TextBlock(COMMENT_BEGIN));
 									singleComment = true;
 									continue;
 								}
@@ -2393,52 +2962,53 @@ void ofxEditor::parseTextBlocks() {
 								}
 								
 								// check ahead for preprocessor begin
-								if(i <= m_text.size()-m_syntax->getWidePreprocessor().length() &&
-								   m_text.substr(i, m_syntax->getWidePreprocessor().length()) == m_syntax->getWidePreprocessor()) {
-									m_textBlocks.push_back(TextBlock(PREPROCESSOR_BEGIN));
+								if((charClass & ofxEditorSyntax::CLASS_PREPROCESSOR) &&
+								   matches(offset, m_syntax->getWidePreprocessor())) {
+									blocks.push_back(TextBlock(PREPROCESSOR_BEGIN));
 									preprocessor = true;
 									continue;
 								}
 								
 								// check for open/close characters
-								if(m_settings->getWideOpenChars().find(m_text[i], 0) != u32string::npos ||
-								   m_settings->getWideCloseChars().find(m_text[i], 0) != u32string::npos) {
-									if(tb.type != UNKNOWN && tb.text.length() > 1) {
-										tb.text = tb.text.substr(0, tb.text.length()-1);
-										m_textBlocks.push_back(tb);
+								if(isMatchingChar(c)) {
+									if(tb.type != UNKNOWN && tb.length > 1) {
+										tb.length--; // remove current char
+										blocks.push_back(tb);
 										tb.clear();
 									}
 									tb.type = MATCHING_CHAR;
-									tb.text = m_text[i];
-									m_textBlocks.push_back(tb);
+									tb.set(offset);
+									blocks.push_back(tb);
 									tb.clear();
+									Bracket bracket = {offset, c};
+									brackets.push_back(bracket);
 									break;
 								}
 								
 								// check for single operator characters
-								if(m_syntax->getWideOperatorChars().find(m_text[i], 0) != u32string::npos) {
-									if(tb.type != UNKNOWN && tb.text.length() > 1) {
-										tb.text = tb.text.substr(0, tb.text.length()-1);
-										m_textBlocks.push_back(tb);
+								if(charClass & ofxEditorSyntax::CLASS_OPERATOR) {
+									if(tb.type != UNKNOWN && tb.length > 1) {
+										tb.length--; // remove current char
+										blocks.push_back(tb);
 										tb.clear();
 									}
 									tb.type = OPERATOR_CHAR;
-									tb.text = m_text[i];
-									m_textBlocks.push_back(tb);
+									tb.set(offset);
+									blocks.push_back(tb);
 									tb.clear();
 									break;
 								}
 								
 								// check for single punctuation characters
-								if(m_syntax->getWidePunctuationChars().find(m_text[i], 0) != u32string::npos) {
-									if(tb.type != UNKNOWN && tb.text.length() > 1) {
-										tb.text = tb.text.substr(0, tb.text.length()-1);
-										m_textBlocks.push_back(tb);
+								if(charClass & ofxEditorSyntax::CLASS_PUNCTUATION) {
+									if(tb.type != UNKNOWN && tb.length > 1) {
+										tb.length--; // remove current char
+										blocks.push_back(tb);
 										tb.clear();
 									}
 									tb.type = PUNCTUATION_CHAR;
-									tb.text = m_text[i];
-									m_textBlocks.push_back(tb);
+									tb.set(offset);
+									blocks.push_back(tb);
 									tb.clear();
 									break;
 								}
@@ -2447,12 +3017,13 @@ void ofxEditor::parseTextBlocks() {
 						else {
 							// check for multi line comment end
 							if(multiComment) {
-								if(tb.text.length() >= m_syntax->getWideMultiLineCommentEnd().length() &&
-									   tb.text.substr(tb.text.length()-m_syntax->getWideMultiLineCommentEnd().length(),
-													  m_syntax->getWideMultiLineCommentEnd().length()) == m_syntax->getWideMultiLineCommentEnd()) {
-									m_textBlocks.push_back(tb); // push latest block
+								const u32string &commentEnd = m_syntax->getWideMultiLineCommentEnd();
+								if((charClass & ofxEditorSyntax::CLASS_COMMENT_END) &&
+								   tb.length >= commentEnd.length() &&
+								   matches(tb.offset+tb.length-commentEnd.length(), commentEnd)) {
+									blocks.push_back(tb); // push latest block
 									tb.clear();
-									m_textBlocks.push_back(TextBlock(COMMENT_END)); // push comment end
+									blocks.push_back(TextBlock(COMMENT_END)); // push comment end
 									multiComment = false;
 									continue;
 								}
@@ -2460,12 +3031,13 @@ void ofxEditor::parseTextBlocks() {
 							
 							// check for string literal end
 							if(stringLiteral) {
-								if(tb.text.length() >= m_syntax->getWideStringLiteralEnd().length() &&
-									   tb.text.substr(tb.text.length()-m_syntax->getWideStringLiteralEnd().length(),
-													  m_syntax->getWideStringLiteralEnd().length()) == m_syntax->getWideStringLiteralEnd()) {
-									m_textBlocks.push_back(tb); // push latest block
+								const u32string &literalEnd = m_syntax->getWideStringLiteralEnd();
+								if((charClass & ofxEditorSyntax::CLASS_LITERAL_END) &&
+								   tb.length >= literalEnd.length() &&
+								   matches(tb.offset+tb.length-literalEnd.length(), literalEnd)) {
+									blocks.push_back(tb); // push latest block
 									tb.clear();
-									m_textBlocks.push_back(TextBlock(LITERAL_END)); // push string literal end
+									blocks.push_back(TextBlock(LITERAL_END)); // push string literal end
 									stringLiteral = false;
 									continue;
 								}
@@ -2482,12 +3054,12 @@ void ofxEditor::parseTextBlocks() {
 	
 	// catch any unfinished blocks at the end
 	if(tb.type != UNKNOWN) {
-		m_textBlocks.push_back(tb);
+		blocks.push_back(tb);
 	}
 	
 	// close preprocessor started on last line
 	if(preprocessor) {
-		m_textBlocks.push_back(TextBlock(PREPROCESSOR_END));
+		blocks.push_back(TextBlock(PREPROCESSOR_END));
 	}
 	
 	// catch any unfinished comments, unfinished multiline comments are a
@@ -2495,11 +3067,224 @@ void ofxEditor::parseTextBlocks() {
 	if(singleComment) {
 		TextBlock commentBlock;
 		commentBlock.type = COMMENT_END;
-		m_textBlocks.push_back(commentBlock);
+		blocks.push_back(commentBlock);
+	}
+	
+	// look up word types once per parse instead of each time the line is drawn
+	if(m_syntax) {
+		for(size_t b = 0; b < blocks.size(); ++b) {
+			if(blocks[b].type == WORD) {
+				blocks[b].word = m_syntax->getWordType(&text[blocks[b].offset], blocks[b].length);
+			}
+		}
 	}
+	
+	// state at the start of the next line
+	ParserState state;
+	state.string = string;
+	state.multiComment = multiComment;
+	state.stringLiteral = stringLiteral;
+	return state;
+}
+
+//--------------------------------------------------------------
+bool ofxEditor::LineParser::matches(size_t offset, const u32string &match) {
+	if(match.empty() || offset + match.length() > m_lineLength) {
+		return false;
+	}
+	return std::char_traits<char32_t>::compare(m_line+offset, match.data(), match.length()) == 0;
+}
+
+//--------------------------------------------------------------
+bool ofxEditor::LineParser::isMatchingChar(char32_t c) {
+	if(c < 256) {
+		return m_matchingCharTable[c];
+	}
+	return m_openChars.find(c) != u32string::npos || m_closeChars.find(c) != u32string::npos;
+}
+
+//--------------------------------------------------------------
+const u32string& ofxEditor::getBlockText(size_t lineStart, const TextBlock &tb) {
+	m_blockText.clear();
+	m_text.copy(m_blockText, lineStart+tb.offset, tb.length);
+	return m_blockText;
 }
 
 //--------------------------------------------------------------
 void ofxEditor::clearTextBlocks() {
-	m_textBlocks.clear();
+	stopHighlighter();
+	m_textLines.clear();
+	m_textLinesParsed = 0;
+	m_cachedLines.clear();
+}
+
+// LINE CACHE
+
+//--------------------------------------------------------------
+bool ofxEditor::LineCacheStyle::operator==(const LineCacheStyle &other) const {
+	if(font != other.font || fontSize != other.fontSize ||
+	   charWidth != other.charWidth || charHeight != other.charHeight ||
+	   colorScheme != other.colorScheme || syntax != other.syntax ||
+	   alpha != other.alpha || textShadow != other.textShadow ||
+	   lineWrapping != other.lineWrapping || lineNumbers != other.lineNumbers ||
+	   visibleWidth != other.visibleWidth || lineNumWidth != other.lineNumWidth ||
+	   tabWidth != other.tabWidth) {
+		return false;
+	}
+	for(int i = 0; i < 10; ++i) {
+		if(colors[i] != other.colors[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxEditor::updateLineCacheStyle() {
+	LineCacheStyle style;
+	style.font = s_font.get();
+	style.fontSize = s_font->getFontSize();
+	style.charWidth = s_charWidth;
+	style.charHeight = s_charHeight;
+	style.colorScheme = m_colorScheme;
+	style.syntax = m_syntax;
+	style.colors[0] = m_settings->getTextColor();
+	style.colors[1] = m_settings->getTextShadowColor();
+	if(m_colorScheme) {
+		style.colors[2] = m_colorScheme->getTextColor();
+		style.colors[3] = m_colorScheme->getStringColor();
+		style.colors[4] = m_colorScheme->getNumberColor();
+		style.colors[5] = m_colorScheme->getCommentColor();
+		style.colors[6] = m_colorScheme->getPreprocessorColor();
+		style.colors[7] = m_colorScheme->getKeywordColor();
+		style.colors[8] = m_colorScheme->getTypenameColor();
+		style.colors[9] = m_colorScheme->getFunctionColor();
+	}
+	style.alpha = m_settings->getAlpha();
+	style.textShadow = s_textShadow;
+	style.lineWrapping = m_lineWrapping;
+	style.lineNumbers = m_lineNumbers;
+	style.visibleWidth = m_visibleWidth;
+	style.lineNumWidth = m_lineNumWidth;
+	style.tabWidth = m_settings->getTabWidth();
+	if(!(style == m_lineCacheStyle)) {
+		m_lineCacheStyle = style;
+		m_lineCacheRevision++;
+		if(m_lineCacheRevision == 0) { // 0 is invalid
+			m_lineCacheRevision = 1;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+bool ofxEditor::rangeHasHighlights(unsigned int start, unsigned int end) {
+	if(m_position >= start && m_position <= end) {
+		return true;
+	}
+	if(m_selection != NONE && m_highlightStart <= end && m_highlightEnd > start) {
+		return true;
+	}
+	if(m_flashSelection && m_flashStart <= end && m_flashEnd > start) {
+		return true;
+	}
+	if(m_matchingCharsHighlight[0] >= 0 && m_matchingCharsHighlight[1] >= 0 &&
+	   (unsigned int)m_matchingCharsHighlight[0] <= end &&
+	   (unsigned int)m_matchingCharsHighlight[1] >= start) {
+		return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+bool ofxEditor::drawLineCache(LineCache &cache, int &x, int &y, unsigned int &textPos,
+                              bool &string, bool &comment, bool &preprocessor) {
+	if(cache.revision != m_lineCacheRevision || cache.x != x ||
+	   m_displayedLineCount + cache.wraps >= m_visibleLines ||
+	   !s_font->drawGeometry(cache.geometry, 0, y)) {
+		return false;
+	}
+	expandBoundingBox(cache.minX, y + cache.minY);
+	expandBoundingBox(cache.maxX, y + cache.maxY);
+	x = cache.endX;
+	y += cache.endY;
+	textPos += cache.length;
+	m_displayedLineCount += cache.wraps;
+	string = cache.string;
+	comment = cache.comment;
+	preprocessor = cache.preprocessor;
+	s_font->setPackedColor(cache.color);
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxEditor::beginLineCache(LineCache &cache, int x, int y) {
+	cache.revision = 0;
+	cache.x = x;
+	m_lineCapture.y = y;
+	m_lineCapture.displayedLineCount = m_displayedLineCount;
+	
+	// collect the line's bounding box separately
+	m_lineCapture.minX = m_BBMinX;
+	m_lineCapture.maxX = m_BBMaxX;
+	m_lineCapture.minY = m_BBMinY;
+	m_lineCapture.maxY = m_BBMaxY;
+	m_BBMinX = m_BBMaxX = x;
+	m_BBMinY = m_BBMaxY = y;
+	
+	s_font->beginCapture();
+}
+
+//--------------------------------------------------------------
+void ofxEditor::endLineCache(size_t line, LineCache &cache, int x, int y, unsigned int length,
+                             bool string, bool comment, bool preprocessor) {
+	s_font->endCapture(cache.geometry, 0, m_lineCapture.y);
+	cache.revision = m_lineCacheRevision;
+	cache.endX = x;
+	cache.endY = y - m_lineCapture.y;
+	cache.length = length;
+	cache.wraps = m_displayedLineCount - m_lineCapture.displayedLineCount;
+	cache.minX = m_BBMinX;
+	cache.maxX = m_BBMaxX;
+	cache.minY = m_BBMinY - m_lineCapture.y;
+	cache.maxY = m_BBMaxY - m_lineCapture.y;
+	cache.string = string;
+	cache.comment = comment;
+	cache.preprocessor = preprocessor;
+	cache.color = s_font->getPackedColor();
+	m_cachedLines.push_back(line);
+	cancelLineCache(); // restore bounding box
+}
+
+//--------------------------------------------------------------
+void ofxEditor::cancelLineCache() {
+	ofxEditorFont::Geometry unused;
+	s_font->endCapture(unused, 0, 0);
+	m_BBMinX = MIN(m_BBMinX, m_lineCapture.minX);
+	m_BBMaxX = MAX(m_BBMaxX, m_lineCapture.maxX);
+	m_BBMinY = MIN(m_BBMinY, m_lineCapture.minY);
+	m_BBMaxY = MAX(m_BBMaxY, m_lineCapture.maxY);
+}
+
+//--------------------------------------------------------------
+void ofxEditor::trimLineCaches(size_t first, size_t last) {
+	size_t maxLines = MAX(m_visibleLines*4, 256);
+	if(m_cachedLines.size() < maxLines) {
+		return;
+	}
+	size_t kept = 0;
+	for(size_t i = 0; i < m_cachedLines.size(); ++i) {
+		size_t line = m_cachedLines[i];
+		if(line >= m_textLines.size()) {
+			continue;
+		}
+		if(line >= first && line <= last) {
+			m_cachedLines[kept++] = line;
+		}
+		else {
+			m_textLines[line].cache = LineCache(); // free memory
+		}
+	}
+	m_cachedLines.resize(kept);
+	std::sort(m_cachedLines.begin(), m_cachedLines.end());
+	m_cachedLines.erase(std::unique(m_cachedLines.begin(), m_cachedLines.end()), m_cachedLines.end());
 }
@@ -25,9 +25,15 @@
 #include "ofMain.h"
 #include "ofxEditorSettings.h"
 #include "ofxEditorColorScheme.h"
+#include "ofxEditorBuffer.h"
+#include "ofxEditorUndo.h"
+#include "ofxEditorJournal.h"
+#include "ofxEditorFont.h"
+
+#include <thread>
+#include <atomic>
 
 // custom fontstash wrapper
-class ofxEditorFont;
 class ofxGLEditor;
 
 /// full screen text editor with optional syntax highlighting,
@@ -48,11 +54,17 @@ class ofxEditor {
 		///
 		/// call this before drawing any editor
 		///
-		static bool loadFont(const std::string &font, int size);
+		/// set headless=true to render text into memory instead of with GL,
+		/// for testing & benchmarking without a GPU or window
+		///
+		static bool loadFont(const std::string &font, int size, bool headless=false);
 	
 		/// is a font currently loaded?
 		static bool isFontLoaded();
 	
+		/// get the global editor font, ie. to read headless draw stats
+		static std::shared_ptr<ofxEditorFont> getFont();
+	
 		/// get the fixed width of the space char using editor font
 		static int getCharWidth();
 	
@@ -98,13 +110,21 @@ class ofxEditor {
 		/// is undo enabled?
 		static bool getUndo();
 	
-		/// set the max number of undo actions to save (default: 10)
-		/// pops oldest actions if new depth is smaller than old depth
+		/// set the max number of undo actions to save, 0 for no limit
+		/// (default: 0), the oldest actions are popped on the next action
+		/// if the new depth is smaller than old depth
 		static void setUndoDepth(unsigned int depth);
 	
 		/// get the current max number of undo actions
 		static unsigned int getUndoDepth();
 	
+		/// set the max size of the undo history in bytes per editor, the
+		/// oldest actions are popped when it's over (default: 1 MB)
+		static void setUndoMaxBytes(size_t bytes);
+	
+		/// get the current max undo history size in bytes
+		static size_t getUndoMaxBytes();
+	
 	/// \section Main
 		
 		/// draw the editor, pushes view and applies viewport
@@ -134,6 +154,11 @@ class ofxEditor {
 		virtual void resize(int width, int height);
 	
 		/// open & load a file, clears existing text
+		///
+		/// the file is memory mapped & decoded into the text buffer before
+		/// returning, the buffer holds 4 bytes per char so opening takes time
+		/// & memory in proportion to the file size
+		///
 		/// returns true on success
 		virtual bool openFile(std::string filename);
 		
@@ -283,14 +308,35 @@ class ofxEditor {
 	
 	/// \section Undo
 	
-		/// undo one action, clears newer redo actions
+		/// undo one action, undone actions are kept as a branch when
+		/// editing after an undo
 		virtual void undo();
 	
-		/// redo one action
+		/// redo one action in the current branch
 		virtual void redo();
 	
+		/// switch the branch the next redo follows to the next older or
+		/// newer branch, returns false if there is no other branch
+		bool switchRedoBranch(bool older=true);
+	
 		/// clear undo actions
 		void clearUndo();
+
+	/// \section Journal
+
+		/// open a crash recovery journal which records every edit & the undo
+		/// history to disk as they happen, if the journal already exists the
+		/// text & undo history are restored from it first
+		///
+		/// returns false if an existing journal couldn't be read
+		bool openJournal(const std::string &path);
+
+		/// close the journal, the file is kept to restore from with the next
+		/// openJournal() unless remove is true
+		void closeJournal(bool remove=false);
+
+		/// is a journal open?
+		bool isJournalOpen();
 	
 	/// \section Utils
 	
@@ -341,13 +387,14 @@ class ofxEditor {
 		// undo
 		static bool s_undo; //< save undo actions?
 		static unsigned int s_undoMaxDepth; //< maximum number of undo actions
+		static size_t s_undoMaxBytes; //< maximum undo history size
 	
 	/// \section Member Variables
 
 		ofxEditorSettings *m_settings; //< editor settings object
 		bool m_sharedSettings; //< are the settings shared? if so, do not delete
 	
-		std::u32string m_text; //< text buffer
+		ofxEditorBuffer m_text; //< piece table text buffer
 		unsigned int m_numLines; //< number of lines in the text buffer
 		
 		float m_width, m_height; //< editor viewport pixel size
@@ -359,6 +406,17 @@ class ofxEditor {
 		int m_visibleLines; //< computed text field num lines
 	
 		int m_matchingCharsHighlight[2]; //< start & end pos for matching chars highlight
+		
+		/// last matching chars lookup, reused until the cursor or text changes
+		struct MatchingChars {
+			bool valid;              //< has there been a lookup?
+			unsigned int pos;        //< cursor pos
+			size_t revision;         //< text buffer revision
+			size_t parsed;           //< parsed lines, the search stops past them
+			ofxEditorSyntax *syntax; //< syntax used to find the chars
+			int highlight[2];        //< found highlight positions
+		};
+		MatchingChars m_matchingChars; //< cached matching chars lookup
 	
 		/// selection states
 		enum SelectionState {
@@ -424,28 +482,185 @@ class ofxEditor {
 			PREPROCESSOR_END,   //< tag only, no text
 		};
 		
-		/// syntax parser custom class to represent a contextual block of text
+		/// syntax parser custom class to represent a contextual block of text,
+		/// references a span of the text buffer instead of copying the text
 		class TextBlock {
 			public:
 				
-				TextBlockType type; //< block type
-				std::u32string text; //< block text string
+				TextBlockType type;  //< block type
+				unsigned int offset; //< block start pos within the line
+				unsigned int length; //< block length in chars
+				ofxEditorSyntax::WordType word; //< syntax word type for WORD blocks
 				
 				TextBlock() {clear();}
-				TextBlock(TextBlockType type) : type(type) {}
-				TextBlock(TextBlockType type, u32string text) : type(type), text(text) {}
+				TextBlock(TextBlockType type) : type(type), offset(0), length(0),
+					word(ofxEditorSyntax::PLAIN) {}
+				TextBlock(TextBlockType type, unsigned int offset, unsigned int length) :
+					type(type), offset(offset), length(length), word(ofxEditorSyntax::PLAIN) {}
 				
-				TextBlock(const TextBlock &from) {
-					type = from.type;
-					text = from.text;
+				/// set to the single char at pos
+				void set(unsigned int pos) {
+					offset = pos;
+					length = 1;
+				}
+				
+				/// append the char at pos, chars in a block are contiguous
+				void append(unsigned int pos) {
+					if(length == 0) {
+						offset = pos;
+					}
+					length++;
 				}
 				
 				void clear() {
 					type = UNKNOWN;
-					text = U"";
+					offset = 0;
+					length = 0;
+					word = ofxEditorSyntax::PLAIN;
 				}
 		};
-		list<TextBlock> m_textBlocks; //< syntax parser text block linked list
+		
+		/// syntax parser state carried over from the previous line, single line
+		/// comments & preprocessor lines always end with the line
+		struct ParserState {
+			int string;         //< open string char or 0
+			bool multiComment;  //< in a multi line comment?
+			bool stringLiteral; //< in a string literal?
+			
+			ParserState() : string(0), multiComment(false), stringLiteral(false) {}
+			
+			bool operator==(const ParserState &other) const {
+				return string == other.string &&
+				       multiComment == other.multiComment &&
+				       stringLiteral == other.stringLiteral;
+			}
+		};
+		
+		/// drawn line glyphs & the draw state at the line end, everything up to
+		/// but not including the ENDLINE so line numbers are always drawn
+		struct LineCache {
+			unsigned int revision; //< style revision when captured, 0 if invalid
+			int x;                 //< line start x pos
+			int endX, endY;        //< x pos & y offset at the line end
+			unsigned int length;   //< number of chars drawn
+			unsigned int wraps;    //< number of wrapped lines
+			float minX, maxX, minY, maxY; //< bounding box, y relative to the line
+			bool string, comment, preprocessor; //< syntax state at the line end
+			unsigned int color;    //< font color at the line end
+			ofxEditorFont::Geometry geometry; //< glyph quads relative to the line
+			LineCache() : revision(0) {}
+		};
+	
+		/// open or close char found by the syntax parser outside of strings
+		/// & comments, aka a MATCHING_CHAR block
+		struct Bracket {
+			unsigned int offset; //< pos within the line
+			char32_t c;          //< the open or close char
+		};
+	
+		/// syntax parser line text blocks
+		struct TextLine {
+			ParserState state;        //< parser state at the line start
+			vector<TextBlock> blocks; //< text blocks including the ENDLINE
+			vector<Bracket> brackets; //< open & close chars in order
+			LineCache cache;          //< drawn line, invalidated when reparsed
+		};
+		vector<TextLine> m_textLines; //< syntax parser text blocks by line
+		ofxEditorSyntax *m_textLinesSyntax; //< syntax used when parsing
+		unsigned int m_textLinesSyntaxRevision; //< syntax revision when parsing
+		size_t m_textLinesParsed; //< lines before this are parsed, the rest are pending
+		u32string m_blockText; //< reusable text block string for word lookups
+		u32string m_lineText;  //< reusable flat copy of the line being parsed
+	
+		/// splits a line into text blocks, keeps everything it needs besides
+		/// the syntax so a separate parser can be used on another thread
+		class LineParser {
+			public:
+			
+				LineParser();
+			
+				/// set the syntax, NULL for plain text
+				void setSyntax(ofxEditorSyntax *syntax);
+			
+				/// set the open & close chars, the lookup table is only
+				/// rebuilt when they change
+				void setMatchingChars(const u32string &openChars, const u32string &closeChars);
+			
+				/// parse length chars of a line, including the line break if
+				/// any, into text blocks & brackets starting with the given
+				/// state, returns the state at the start of the next line
+				ParserState parse(const char32_t *text, size_t length, const ParserState &state,
+				                  vector<TextBlock> &blocks, vector<Bracket> &brackets);
+			
+			private:
+			
+				ofxEditorSyntax *m_syntax;     //< current syntax or NULL
+				bool m_matchingCharTable[256]; //< open & close chars below 256
+				u32string m_openChars;         //< open chars for the table
+				u32string m_closeChars;        //< close chars for the table
+				const char32_t *m_line;        //< line being parsed
+				size_t m_lineLength;           //< length of the line being parsed
+			
+				/// does the line being parsed match a given string at an offset?
+				/// an empty string never matches, ie. an unset syntax delimiter
+				bool matches(size_t offset, const u32string &match);
+			
+				/// is c one of the open or close chars?
+				bool isMatchingChar(char32_t c);
+		};
+		LineParser m_lineParser; //< parser used on the main thread
+	
+		/// parses the pending lines on a worker thread from a snapshot of the
+		/// text, the results are only used if the text & syntax are unchanged
+		struct Highlighter {
+			std::thread thread;         //< worker thread
+			std::atomic<bool> done;     //< finished parsing?
+			std::atomic<bool> cancel;   //< stop parsing as soon as possible?
+			size_t revision;            //< buffer revision of the snapshot
+			ofxEditorSyntax *syntax;    //< editor syntax when started
+			unsigned int syntaxRevision; //< editor syntax revision when started
+			size_t first;               //< first line to parse
+			size_t start;               //< buffer pos of the first line
+			ParserState state;          //< parser state at the first line
+			ofxEditorBuffer::Snapshot text; //< text snapshot, shares the buffer's text
+			ofxEditorSyntax syntaxCopy; //< syntax copy used by the worker
+			LineParser parser;          //< parser used by the worker
+			vector<TextLine> lines;     //< parsed lines starting at the first line
+			ParserState endState;       //< parser state after the last parsed line
+			
+			Highlighter() : done(false), cancel(false) {}
+			
+			/// parse the snapshot into lines, runs on the worker thread
+			void run();
+		};
+		Highlighter *m_highlighter; //< running background parser or NULL
+		size_t m_highlighterRevision; //< buffer revision when last updated
+	
+	/// \section Line Cache Types
+	
+		/// everything besides the text which affects how a line is drawn
+		struct LineCacheStyle {
+			ofxEditorFont *font;
+			int fontSize, charWidth, charHeight;
+			ofxEditorColorScheme *colorScheme;
+			ofxEditorSyntax *syntax;
+			ofColor colors[10];
+			float alpha;
+			bool textShadow, lineWrapping, lineNumbers;
+			int visibleWidth, lineNumWidth, tabWidth;
+			bool operator==(const LineCacheStyle &other) const;
+		};
+		LineCacheStyle m_lineCacheStyle; //< style of the cached lines
+		unsigned int m_lineCacheRevision; //< current style revision, starts at 1
+		vector<size_t> m_cachedLines; //< lines captured since the last trim & the kept lines, may repeat
+	
+		/// line being captured
+		struct LineCapture {
+			int y; //< line start y pos
+			unsigned int displayedLineCount; //< displayed lines at the line start
+			float minX, maxX, minY, maxY; //< bounding box before the line
+		};
+		LineCapture m_lineCapture;
 	
 	/// \section Undo Types
 	
@@ -458,36 +673,8 @@ class ofxEditor {
 			ACTION_DELETE     //< text deleted to the right
 		};
 	
-		/// undo action state
-		class UndoAction {
-			public:
-			
-				UndoActionType type; //< action type
-				std::u32string insertText, deleteText; //< any added/removed text
-				unsigned int pos; //< text position
-				long timestamp; //< timestamp of last update
-			
-				UndoAction() {clear();}
-				
-				UndoAction(const UndoAction &from) {
-					type = from.type;
-					insertText = from.insertText;
-					deleteText = from.deleteText;
-					pos = from.pos;
-					timestamp = from.timestamp;
-				}
-			
-				void clear() {
-					type = ACTION_INSERT;
-					insertText = U"";
-					deleteText = U"";
-					pos = 0;
-					timestamp = ofGetElapsedTimeMillis();
-				}
-			
-		};
-		std::vector<UndoAction> m_undoActions; //< current undo actions
-		int m_undoPos; //< current undo position, -1 denotes no undos left
+		ofxEditorUndo m_undo; //< undo history tree
+		ofxEditorJournal m_journal; //< crash recovery journal
 	
 	/// \section Helper Functions
 	
@@ -513,6 +700,18 @@ class ofxEditor {
 		/// replace tabs in buffer with spaces
 		void processTabs();
 	
+		/// copy text to expanded with tabs replaced by spaces in a single
+		/// pass, returns false & leaves expanded unchanged if there are no tabs
+		bool expandTabs(const u32string &text, u32string &expanded);
+	
+		/// get the current line before replacing the buffer contents,
+		/// returns -1 if the buffer is empty
+		int textReplacing();
+	
+		/// restore the current line & update after replacing the buffer
+		/// contents, line is from textReplacing()
+		void textReplaced(int line);
+	
 		/// get offset in buffer to the current line
 		int offsetToCurrentLineStart();
 	
@@ -540,6 +739,20 @@ class ofxEditor {
 		/// look backward for an open char
 		void parseCloseChars(int pos, int type);
 	
+		/// find the bracket at a line pos, returns -1 if not found
+		int findBracket(size_t line, unsigned int offset);
+	
+		/// look forward through the parsed lines for the close char matching
+		/// a bracket, up to MATCHING_CHAR_LINES lines & HIGHLIGHT_SYNC_LINES
+		/// pending lines are parsed on the way, returns the buffer pos or -1
+		/// if not found
+		int matchOpenBracket(size_t line, int index, int type);
+	
+		/// look backward through the parsed lines for the open char matching
+		/// a bracket, up to MATCHING_CHAR_LINES lines, returns the buffer pos
+		/// or -1 if not found
+		int matchCloseBracket(size_t line, int index, int type);
+	
 		/// get the number of lines at a buffer pos
 		unsigned int lineNumberForPos(unsigned int pos);
 	
@@ -564,25 +777,91 @@ class ofxEditor {
 		// clear the autofocus bounding box
 		void clearBoundingBox();
 	
-		/// text buffer changed, so update syntax text blocks and/or other info
-		///
-		/// TODO: replace this brute force method with a link list pointer based
-		/// approach that updates only those text blocks around the current
-		/// editor area
+		/// text buffer changed, so update syntax text blocks and/or other info,
+		/// only the changed lines are reparsed
 		void textBufferUpdated();
 	
 		/// update visible char size based on pixel size, char size, & auto focus
 		void updateVisibleSize();
 	
-		/// update undo state, creates of modifies actions using timeout
-		/// on new input, clears actions newer than current undo pos
+		/// update undo state, extends the current action with contiguous
+		/// input of the same type until timeout, otherwise adds a new action
 		void updateUndo(UndoActionType type, unsigned int pos, const u32string &insertText, const u32string &deleteText);
 	
+		/// replace length chars at pos with text for undo & redo
+		void applyUndo(unsigned int pos, size_t length, const u32string &text);
+	
 	private:
 	
-		/// parses text into text blocks
+		/// parses text into text blocks, only the visible lines are parsed
+		/// right away & the rest are parsed when first drawn
 		void parseTextBlocks();
 		
+		/// reparses changed lines into text blocks until the parser state
+		/// matches that of the following unchanged lines
+		void updateTextBlocks();
+		
+		/// parses pending lines up to & including line
+		void parseTextLinesTo(size_t line);
+		
+		/// get the last line which could be visible from the top text position
+		size_t lastVisibleLine();
+		
+		/// parses a single line into text blocks using the line's start state,
+		/// returns the parser state at the start of the next line
+		ParserState parseTextLine(size_t line);
+		
+		/// parses lines with plain text blocks for drawing without changing
+		/// the pending lines, used while waiting for the background parser
+		void parsePlainTextLines(size_t first, size_t last);
+	
+	/// \section Background Parsing
+	
+		/// use finished background parser results, stop it if they would be
+		/// stale, & start it when there are many pending lines & edits pause
+		void updateHighlighter();
+	
+		/// start the background parser on the pending lines
+		void startHighlighter();
+	
+		/// stop & delete the background parser, discards any results
+		void stopHighlighter();
+	
+		/// is the background parser running?
+		bool isHighlighterRunning();
+		
+		/// get the text of a block in a line starting at a buffer pos,
+		/// reuses the same string so the reference is valid until the next call
+		const u32string& getBlockText(size_t lineStart, const TextBlock &tb);
+		
 		/// clears current text block list
 		void clearTextBlocks();
+	
+	/// \section Line Cache
+	
+		/// bump the line cache revision if the current draw style has changed
+		void updateLineCacheStyle();
+	
+		/// does a buffer range have any per-char highlights which aren't
+		/// cached: cursor, selection, flash, or matching chars?
+		bool rangeHasHighlights(unsigned int start, unsigned int end);
+	
+		/// redraw a cached line at y & restore the draw state at the line end,
+		/// returns false if the cache can't be used
+		bool drawLineCache(LineCache &cache, int &x, int &y, unsigned int &textPos,
+		                   bool &string, bool &comment, bool &preprocessor);
+	
+		/// start capturing a line drawn at x & y
+		void beginLineCache(LineCache &cache, int x, int y);
+	
+		/// finish capturing a line & save the draw state at the line end
+		void endLineCache(size_t line, LineCache &cache, int x, int y, unsigned int length,
+		                  bool string, bool comment, bool preprocessor);
+	
+		/// stop capturing a line which could not be drawn fully
+		void cancelLineCache();
+	
+		/// free cached lines outside of [first, last] if too many have been
+		/// captured since the last trim, only the captured lines are visited
+		void trimLineCaches(size_t first, size_t last);
 };
@@ -0,0 +1,955 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#include "ofxEditorBuffer.h"
+#include "ofxEditorJournal.h"
+#include "Unicode.h"
+
+#include <algorithm>
+#include <atomic>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+// UTF-8 is decoded & indexed in chunks of this many bytes so the decoded
+// chars are still in the cache when scanned for line breaks
+#define DECODE_CHUNK 65536
+
+// don't bother compacting when less than this many chars are unused
+#define MIN_COMPACT_CHARS 4096
+
+//--------------------------------------------------------------
+ofxEditorBuffer::ofxEditorBuffer() {
+	m_root = NULL;
+	m_numPieces = 0;
+	m_seed = 0x9E3779B9;
+	m_cachePiece = NULL;
+	m_cacheStart = 0;
+	m_lastInsertEnd = npos;
+	m_changed = true;
+	m_changedAll = true;
+	m_changedFirst = m_changedLast = 0;
+	m_baseLineBreaks = 0;
+	m_revision = 0;
+	m_journal = NULL;
+	m_original = std::make_shared<std::u32string>();
+	m_added = std::make_shared<std::u32string>();
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer::ofxEditorBuffer(const std::u32string &text) {
+	m_root = NULL;
+	m_numPieces = 0;
+	m_seed = 0x9E3779B9;
+	m_cachePiece = NULL;
+	m_cacheStart = 0;
+	m_lastInsertEnd = npos;
+	m_changed = true;
+	m_changedAll = true;
+	m_changedFirst = m_changedLast = 0;
+	m_baseLineBreaks = 0;
+	m_revision = 0;
+	m_journal = NULL;
+	m_original = std::make_shared<std::u32string>();
+	m_added = std::make_shared<std::u32string>();
+	assign(text);
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer::ofxEditorBuffer(const ofxEditorBuffer &from) {
+	m_root = NULL;
+	m_numPieces = 0;
+	m_seed = 0x9E3779B9;
+	m_cachePiece = NULL;
+	m_cacheStart = 0;
+	m_lastInsertEnd = npos;
+	m_changed = true;
+	m_changedAll = true;
+	m_changedFirst = m_changedLast = 0;
+	m_baseLineBreaks = 0;
+	m_revision = 0;
+	m_journal = NULL;
+	m_original = std::make_shared<std::u32string>();
+	m_added = std::make_shared<std::u32string>();
+	assign(from.getText());
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer& ofxEditorBuffer::operator=(const ofxEditorBuffer &from) {
+	if(this != &from) {
+		assign(from.getText());
+	}
+	return *this;
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer& ofxEditorBuffer::operator=(const std::u32string &text) {
+	assign(text);
+	return *this;
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer::~ofxEditorBuffer() {
+	destroy(m_root);
+}
+
+// EDIT
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::assign(const std::u32string &text) {
+	reset();
+	*m_original = text;
+	indexLineBreaks(m_originalBreaks, m_original->data(), m_original->size(), 0);
+	if(!m_original->empty()) {
+		m_root = createPiece(false, 0, m_original->size());
+	}
+	if(m_journal) {
+		m_journal->assign();
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::assign(const char *text, size_t len) {
+	reset();
+	m_original->reserve(len); // never more chars than bytes
+	size_t i = 0;
+	while(i < len) {
+		size_t n = std::min(len-i, (size_t)DECODE_CHUNK);
+		if(i+n < len) {
+			// end the chunk before a continuation byte so a multi byte char
+			// isn't split, a valid char has at most 3 continuation bytes
+			size_t end = n;
+			while(end > n-3 && (text[i+end] & 0xC0) == 0x80) {
+				end--;
+			}
+			if((text[i+end] & 0xC0) != 0x80) {
+				n = end;
+			}
+		}
+		size_t start = m_original->size();
+		string_append(*m_original, text+i, n);
+		indexLineBreaks(m_originalBreaks, m_original->data()+start, m_original->size()-start, start);
+		i += n;
+	}
+	if(!m_original->empty()) {
+		m_root = createPiece(false, 0, m_original->size());
+	}
+	if(m_journal) {
+		m_journal->assign();
+	}
+}
+
+//--------------------------------------------------------------
+bool ofxEditorBuffer::assignFile(const std::string &path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+	                          OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return false;
+	}
+	if(size.QuadPart == 0) { // empty files can't be mapped
+		CloseHandle(file);
+		assign(NULL, 0);
+		return true;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const char *data = NULL;
+	if(mapping) {
+		data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if(!data) {
+		if(mapping) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	assign(data, (size_t)size.QuadPart);
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	CloseHandle(file);
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) < 0 || !S_ISREG(info.st_mode)) {
+		close(fd);
+		return false;
+	}
+	size_t size = info.st_size;
+	if(size == 0) { // empty files can't be mapped
+		close(fd);
+		assign(NULL, 0);
+		return true;
+	}
+	void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps the file open
+	if(data == MAP_FAILED) {
+		return false;
+	}
+	madvise(data, size, MADV_SEQUENTIAL);
+	assign((const char *)data, size);
+	munmap(data, size);
+#endif
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::insert(size_t pos, const std::u32string &text) {
+	insert(pos, text.data(), text.size());
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::insert(size_t pos, const char32_t *text, size_t len) {
+	if(len == 0) {
+		return;
+	}
+	pos = std::min(pos, size());
+	if(m_journal) {
+		m_journal->insert(pos, text, len);
+	}
+	m_cachePiece = NULL;
+	size_t line = getLineForPos(pos);
+	size_t numBreaks = getNumLineBreaks();
+
+	// typing appends to the last piece instead of creating a new one
+	if(extendLastInsert(pos, text, len)) {
+		m_lastInsertEnd = pos+len;
+		markChanged(line, 0, getNumLineBreaks()-numBreaks);
+		return;
+	}
+
+	indexLineBreaks(m_addedBreaks, text, len, m_added->size());
+	detachAdded();
+	m_added->append(text, len);
+	Piece *piece = createPiece(true, m_added->size()-len, len);
+	Piece *l, *r;
+	split(m_root, pos, l, r);
+	m_root = merge(merge(l, piece), r);
+	m_lastInsertEnd = pos+len;
+	markChanged(line, 0, getNumLineBreaks()-numBreaks);
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::append(const std::u32string &text) {
+	insert(size(), text.data(), text.size());
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer& ofxEditorBuffer::operator+=(const std::u32string &text) {
+	append(text);
+	return *this;
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer& ofxEditorBuffer::operator+=(char32_t c) {
+	insert(size(), &c, 1);
+	return *this;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::erase(size_t pos, size_t len) {
+	size_t total = size();
+	if(pos >= total || len == 0) {
+		return;
+	}
+	len = std::min(len, total-pos);
+	if(m_journal) {
+		m_journal->erase(pos, len);
+	}
+	m_cachePiece = NULL;
+	m_lastInsertEnd = npos;
+	if(pos == 0 && len == total) {
+		reset();
+		return;
+	}
+	Piece *l, *m, *r;
+	split(m_root, pos, l, m);
+	split(m, len, m, r);
+	size_t line = lineBreaksOf(l);
+	size_t numBreaks = lineBreaksOf(m);
+	destroy(m);
+	m_root = merge(l, r);
+	markChanged(line, numBreaks, 0);
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::resize(size_t len, char32_t c) {
+	size_t total = size();
+	if(len < total) {
+		erase(len);
+	}
+	else if(len > total) {
+		append(std::u32string(len-total, c));
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::clear() {
+	if(m_journal) {
+		m_journal->clear();
+	}
+	reset();
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::compact() {
+	size_t total = size();
+	size_t unused = m_original->size() + m_added->size() - total;
+	if(unused < MIN_COMPACT_CHARS || unused <= total) {
+		return;
+	}
+
+	// same text & lines, so changes & the revision stay as they are
+	std::u32string text;
+	text.reserve(total);
+	copy(text, 0);
+	destroy(m_root);
+	m_root = NULL;
+	m_numPieces = 0;
+	m_original = std::make_shared<std::u32string>(std::move(text));
+	m_added = std::make_shared<std::u32string>();
+	m_originalBreaks.clear();
+	std::vector<size_t>().swap(m_addedBreaks);
+	indexLineBreaks(m_originalBreaks, m_original->data(), m_original->size(), 0);
+	if(!m_original->empty()) {
+		m_root = createPiece(false, 0, m_original->size());
+	}
+	m_cachePiece = NULL;
+	m_cacheStart = 0;
+	m_lastInsertEnd = npos;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::setJournal(ofxEditorJournal *journal) {
+	m_journal = journal;
+}
+
+//--------------------------------------------------------------
+ofxEditorJournal* ofxEditorBuffer::getJournal() {
+	return m_journal;
+}
+
+// ACCESS
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::size() const {
+	return sizeOf(m_root);
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::length() const {
+	return sizeOf(m_root);
+}
+
+//--------------------------------------------------------------
+bool ofxEditorBuffer::empty() const {
+	return m_root == NULL;
+}
+
+//--------------------------------------------------------------
+char32_t ofxEditorBuffer::at(size_t pos) const {
+	if(m_cachePiece == NULL || pos < m_cacheStart || pos >= m_cacheStart+m_cachePiece->length) {
+		size_t start;
+		const Piece *p = findPiece(pos, start);
+		if(!p) {
+			return 0;
+		}
+		m_cachePiece = p;
+		m_cacheStart = start;
+	}
+	return source(m_cachePiece)[m_cachePiece->start+(pos-m_cacheStart)];
+}
+
+//--------------------------------------------------------------
+char32_t ofxEditorBuffer::operator[](size_t pos) const {
+	return at(pos);
+}
+
+//--------------------------------------------------------------
+std::u32string ofxEditorBuffer::substr(size_t pos, size_t len) const {
+	std::u32string s;
+	copy(s, pos, len);
+	return s;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::copy(std::u32string &dest, size_t pos, size_t len) const {
+	size_t total = size();
+	if(pos >= total) {
+		return;
+	}
+	len = std::min(len, total-pos);
+	dest.reserve(dest.size()+len);
+	auto append = [&dest](const char32_t *chunk, size_t n, size_t /*chunkPos*/) {
+		dest.append(chunk, n);
+		return true;
+	};
+	visit(m_root, 0, pos, len, append);
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::copy(std::string &dest, size_t pos, size_t len) const {
+	size_t total = size();
+	if(pos >= total) {
+		return;
+	}
+	len = std::min(len, total-pos);
+	dest.reserve(dest.size()+len);
+	auto append = [&dest](const char32_t *chunk, size_t n, size_t /*chunkPos*/) {
+		wstring_append(dest, chunk, n);
+		return true;
+	};
+	visit(m_root, 0, pos, len, append);
+}
+
+//--------------------------------------------------------------
+std::u32string ofxEditorBuffer::getText() const {
+	return substr(0);
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::find(char32_t c, size_t pos) const {
+	size_t total = size();
+	if(pos >= total) {
+		return npos;
+	}
+	size_t found = npos;
+	auto search = [c, &found](const char32_t *chunk, size_t n, size_t chunkPos) {
+		const char32_t *f = std::char_traits<char32_t>::find(chunk, n, c);
+		if(f) {
+			found = chunkPos + (f-chunk);
+			return false;
+		}
+		return true;
+	};
+	visit(m_root, 0, pos, total-pos, search);
+	return found;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::rfind(char32_t c, size_t pos) const {
+	size_t total = size();
+	if(total == 0) {
+		return npos;
+	}
+	pos = std::min(pos, total-1);
+	size_t found = npos;
+	auto search = [c, &found](const char32_t *chunk, size_t n, size_t chunkPos) {
+		for(size_t i = n; i > 0; --i) {
+			if(chunk[i-1] == c) {
+				found = chunkPos+i-1;
+				return false;
+			}
+		}
+		return true;
+	};
+	visitReverse(m_root, 0, 0, pos+1, search);
+	return found;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::count(char32_t c, size_t pos, size_t len) const {
+	size_t total = size();
+	if(pos >= total) {
+		return 0;
+	}
+	len = std::min(len, total-pos);
+	size_t num = 0;
+	auto counter = [c, &num](const char32_t *chunk, size_t n, size_t /*chunkPos*/) {
+		num += std::count(chunk, chunk+n, c);
+		return true;
+	};
+	visit(m_root, 0, pos, len, counter);
+	return num;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::getNumPieces() const {
+	return m_numPieces;
+}
+
+// SNAPSHOT
+
+//--------------------------------------------------------------
+ofxEditorBuffer::Snapshot::Snapshot() {
+	m_size = 0;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::Snapshot::size() const {
+	return m_size;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::Snapshot::copy(std::string &dest, size_t pos, size_t len) const {
+	if(pos >= m_size) {
+		return;
+	}
+	dest.reserve(dest.size()+std::min(len, m_size-pos));
+	auto append = [&dest](const char32_t *chunk, size_t n, size_t /*chunkPos*/) {
+		wstring_append(dest, chunk, n);
+		return true;
+	};
+	visit(pos, len, append);
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer::Snapshot ofxEditorBuffer::snapshot() const {
+	Snapshot snapshot;
+	snapshot.m_original = m_original;
+	snapshot.m_added = m_added;
+	snapshot.m_size = size();
+	snapshot.m_spans.reserve(m_numPieces);
+
+	// in order walk, the treap is O(log n) deep
+	std::vector<const Piece *> stack;
+	const Piece *p = m_root;
+	while(p || !stack.empty()) {
+		while(p) {
+			stack.push_back(p);
+			p = p->left;
+		}
+		p = stack.back();
+		stack.pop_back();
+		Snapshot::Span span = {p->added, p->start, p->length};
+		snapshot.m_spans.push_back(span);
+		p = p->right;
+	}
+	return snapshot;
+}
+
+// LINES
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::getNumLineBreaks() const {
+	return lineBreaksOf(m_root);
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::getLineForPos(size_t pos) const {
+	const Piece *p = m_root;
+	size_t offset = 0, line = 0;
+	while(p) {
+		size_t leftSize = sizeOf(p->left);
+		if(pos < offset + leftSize) {
+			p = p->left;
+		}
+		else if(pos < offset + leftSize + p->length) {
+			size_t pieceStart = offset + leftSize;
+			return line + lineBreaksOf(p->left) +
+				countLineBreaks(p->added, p->start, pos - pieceStart);
+		}
+		else {
+			offset += leftSize + p->length;
+			line += lineBreaksOf(p->left) + p->lineBreaks;
+			p = p->right;
+		}
+	}
+	return line; // past the end
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::getLineStart(size_t line) const {
+	if(line == 0) {
+		return 0;
+	}
+	if(line > getNumLineBreaks()) {
+		return size();
+	}
+	return findLineBreak(line)+1;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::getLineEnd(size_t line) const {
+	if(line >= getNumLineBreaks()) {
+		return size();
+	}
+	return findLineBreak(line+1);
+}
+
+// CHANGES
+
+//--------------------------------------------------------------
+bool ofxEditorBuffer::getChangedLines(size_t &first, size_t &last, long &delta) const {
+	if(!m_changed) {
+		return false;
+	}
+	size_t numBreaks = getNumLineBreaks();
+	if(m_changedAll) {
+		first = 0;
+		last = numBreaks;
+	}
+	else {
+		first = m_changedFirst;
+		last = std::min(m_changedLast, numBreaks);
+	}
+	delta = (long)numBreaks - (long)m_baseLineBreaks;
+	return true;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::getRevision() const {
+	return m_revision;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::clearChanges() {
+	m_changed = false;
+	m_changedAll = false;
+	m_changedFirst = m_changedLast = 0;
+	m_baseLineBreaks = getNumLineBreaks();
+}
+
+// PROTECTED
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::reset() {
+	destroy(m_root);
+	m_root = NULL;
+	m_numPieces = 0;
+	m_original = std::make_shared<std::u32string>(); // snapshots keep the old text
+	m_added = std::make_shared<std::u32string>();
+	m_originalBreaks.clear();
+	m_addedBreaks.clear();
+	m_cachePiece = NULL;
+	m_cacheStart = 0;
+	m_lastInsertEnd = npos;
+	m_changed = true;
+	m_changedAll = true;
+	m_revision++;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::countLineBreaks(bool added, size_t start, size_t length) const {
+	const std::vector<size_t> &breaks = added ? m_addedBreaks : m_originalBreaks;
+	auto first = std::lower_bound(breaks.begin(), breaks.end(), start);
+	auto last = std::lower_bound(first, breaks.end(), start+length);
+	return last - first;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::indexLineBreaks(std::vector<size_t> &breaks, const char32_t *text, size_t len, size_t offset) {
+	for(size_t i = 0; i < len; ++i) {
+		if(text[i] == '\n') {
+			breaks.push_back(offset+i);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::findLineBreak(size_t n) const {
+	const Piece *p = m_root;
+	size_t offset = 0;
+	while(p) {
+		size_t leftBreaks = lineBreaksOf(p->left);
+		if(n <= leftBreaks) {
+			p = p->left;
+		}
+		else if(n <= leftBreaks + p->lineBreaks) {
+			// nth break within the piece, look it up in the source index
+			const std::vector<size_t> &breaks = p->added ? m_addedBreaks : m_originalBreaks;
+			auto first = std::lower_bound(breaks.begin(), breaks.end(), p->start);
+			size_t breakPos = *(first + (n - leftBreaks - 1));
+			return offset + sizeOf(p->left) + (breakPos - p->start);
+		}
+		else {
+			n -= leftBreaks + p->lineBreaks;
+			offset += sizeOf(p->left) + p->length;
+			p = p->right;
+		}
+	}
+	return npos;
+}
+
+
+//--------------------------------------------------------------
+const char32_t* ofxEditorBuffer::source(const Piece *p) const {
+	return p->added ? m_added->data() : m_original->data();
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::detachAdded() {
+	if(m_added.use_count() > 1) {
+		std::shared_ptr<std::u32string> added = std::make_shared<std::u32string>();
+		added->reserve(m_added->capacity());
+		added->append(*m_added);
+		m_added = added;
+	}
+	else {
+		// pairs with the release when a snapshot on another thread drops
+		// the text so its reads are done before appending
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::markChanged(size_t line, size_t removed, size_t added) {
+	m_revision++;
+	if(m_changedAll) {
+		return;
+	}
+	if(!m_changed) {
+		m_changed = true;
+		m_changedFirst = m_changedLast = line;
+	}
+	else {
+		m_changedFirst = std::min(m_changedFirst, line);
+		if(m_changedLast > line + removed) {
+			m_changedLast -= removed; // shift up past the removed lines
+		}
+		else {
+			m_changedLast = line; // within or before the edit
+		}
+	}
+	m_changedLast += added;
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer::Piece* ofxEditorBuffer::createPiece(bool added, size_t start, size_t length) {
+	Piece *p = new Piece;
+	p->added = added;
+	p->start = start;
+	p->length = length;
+	p->size = length;
+	p->lineBreaks = countLineBreaks(added, start, length);
+	p->totalLineBreaks = p->lineBreaks;
+	p->priority = nextPriority();
+	p->left = NULL;
+	p->right = NULL;
+	m_numPieces++;
+	return p;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::destroy(Piece *p) {
+	if(!p) {
+		return;
+	}
+	destroy(p->left);
+	destroy(p->right);
+	delete p;
+	m_numPieces--;
+}
+
+//--------------------------------------------------------------
+unsigned int ofxEditorBuffer::nextPriority() {
+	// xorshift32
+	m_seed ^= m_seed << 13;
+	m_seed ^= m_seed >> 17;
+	m_seed ^= m_seed << 5;
+	return m_seed;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::update(Piece *p) {
+	p->size = sizeOf(p->left) + p->length + sizeOf(p->right);
+	p->totalLineBreaks = lineBreaksOf(p->left) + p->lineBreaks + lineBreaksOf(p->right);
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::sizeOf(const Piece *p) {
+	return p ? p->size : 0;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorBuffer::lineBreaksOf(const Piece *p) {
+	return p ? p->totalLineBreaks : 0;
+}
+
+//--------------------------------------------------------------
+void ofxEditorBuffer::split(Piece *t, size_t pos, Piece *&l, Piece *&r) {
+	if(!t) {
+		l = r = NULL;
+		return;
+	}
+	size_t leftSize = sizeOf(t->left);
+	if(pos <= leftSize) {
+		split(t->left, pos, l, t->left);
+		update(t);
+		r = t;
+	}
+	else if(pos >= leftSize + t->length) {
+		split(t->right, pos - leftSize - t->length, t->right, r);
+		update(t);
+		l = t;
+	}
+	else {
+		// split within the piece, the right half takes over the right
+		// subtree and shares the priority so both halves keep heap order
+		size_t offset = pos - leftSize;
+		Piece *p = createPiece(t->added, t->start+offset, t->length-offset);
+		p->priority = t->priority;
+		p->right = t->right;
+		t->right = NULL;
+		t->length = offset;
+		t->lineBreaks -= p->lineBreaks;
+		update(p);
+		update(t);
+		l = t;
+		r = p;
+	}
+}
+
+//--------------------------------------------------------------
+ofxEditorBuffer::Piece* ofxEditorBuffer::merge(Piece *l, Piece *r) {
+	if(!l) return r;
+	if(!r) return l;
+	if(l->priority > r->priority) {
+		l->right = merge(l->right, r);
+		update(l);
+		return l;
+	}
+	r->left = merge(l, r->left);
+	update(r);
+	return r;
+}
+
+//--------------------------------------------------------------
+const ofxEditorBuffer::Piece* ofxEditorBuffer::findPiece(size_t pos, size_t &pieceStart) const {
+	const Piece *p = m_root;
+	size_t offset = 0;
+	while(p) {
+		size_t leftSize = sizeOf(p->left);
+		if(pos < offset + leftSize) {
+			p = p->left;
+		}
+		else if(pos < offset + leftSize + p->length) {
+			pieceStart = offset + leftSize;
+			return p;
+		}
+		else {
+			offset += leftSize + p->length;
+			p = p->right;
+		}
+	}
+	return NULL;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorBuffer::extendLastInsert(size_t pos, const char32_t *text, size_t len) {
+	if(pos == 0 || pos != m_lastInsertEnd) {
+		return false;
+	}
+
+	// piece before pos must end at the end of the add buffer
+	size_t start;
+	const Piece *found = findPiece(pos-1, start);
+	if(!found || !found->added || start + found->length != pos ||
+	   found->start + found->length != m_added->size()) {
+		return false;
+	}
+
+	// grow the piece & the subtree sizes along the path
+	size_t numBreaks = m_addedBreaks.size();
+	indexLineBreaks(m_addedBreaks, text, len, m_added->size());
+	numBreaks = m_addedBreaks.size() - numBreaks;
+	Piece *p = m_root;
+	size_t offset = 0;
+	while(p) {
+		p->size += len;
+		p->totalLineBreaks += numBreaks;
+		size_t leftSize = sizeOf(p->left);
+		if(p == found) {
+			p->length += len;
+			p->lineBreaks += numBreaks;
+			break;
+		}
+		if(pos-1 < offset + leftSize) {
+			p = p->left;
+		}
+		else {
+			offset += leftSize + p->length;
+			p = p->right;
+		}
+	}
+	detachAdded();
+	m_added->append(text, len);
+	return true;
+}
+
+//--------------------------------------------------------------
+template<typename Visitor>
+bool ofxEditorBuffer::visit(const Piece *p, size_t offset, size_t pos, size_t len, Visitor &v) const {
+	if(!p) {
+		return true;
+	}
+	size_t end = pos + len;
+	if(end <= offset || pos >= offset + p->size) {
+		return true;
+	}
+	size_t pieceStart = offset + sizeOf(p->left);
+	size_t pieceEnd = pieceStart + p->length;
+	if(pos < pieceStart && !visit(p->left, offset, pos, len, v)) {
+		return false;
+	}
+	if(pos < pieceEnd && end > pieceStart) {
+		size_t a = std::max(pos, pieceStart);
+		size_t b = std::min(end, pieceEnd);
+		if(!v(source(p) + p->start + (a-pieceStart), b-a, a)) {
+			return false;
+		}
+	}
+	if(end > pieceEnd) {
+		return visit(p->right, pieceEnd, pos, len, v);
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+template<typename Visitor>
+bool ofxEditorBuffer::visitReverse(const Piece *p, size_t offset, size_t pos, size_t len, Visitor &v) const {
+	if(!p) {
+		return true;
+	}
+	size_t end = pos + len;
+	if(end <= offset || pos >= offset + p->size) {
+		return true;
+	}
+	size_t pieceStart = offset + sizeOf(p->left);
+	size_t pieceEnd = pieceStart + p->length;
+	if(end > pieceEnd && !visitReverse(p->right, pieceEnd, pos, len, v)) {
+		return false;
+	}
+	if(pos < pieceEnd && end > pieceStart) {
+		size_t a = std::max(pos, pieceStart);
+		size_t b = std::min(end, pieceEnd);
+		if(!v(source(p) + p->start + (a-pieceStart), b-a, a)) {
+			return false;
+		}
+	}
+	if(pos < pieceStart) {
+		return visitReverse(p->left, offset, pos, len, v);
+	}
+	return true;
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+
+class ofxEditorJournal;
+
+/// wide char piece table text buffer
+///
+/// the text is stored as a sequence of pieces which reference either the
+/// original text or an append-only add buffer, pieces are kept in a balanced
+/// tree (treap) ordered by buffer position so inserts & erases are O(log n)
+/// and only split or create a few pieces instead of shifting the whole text
+///
+/// char access is O(log n) in general, however sequential access (aka
+/// drawing) is O(1) as the last accessed piece is cached
+///
+/// line breaks are indexed per source buffer and counted per piece subtree so
+/// line <-> buffer pos lookups are O(log n) & are updated with each edit
+///
+/// the range of changed lines is tracked between calls to clearChanges() so
+/// line based caches, aka syntax highlighting, can be updated incrementally
+///
+/// the API mirrors the std::u32string methods used by the editor, a flat
+/// string is only built when calling getText()
+///
+/// edits can be recorded to a journal for crash recovery, see setJournal()
+///
+/// note: const access updates the piece cache, so a buffer should not be read
+///       from multiple threads at the same time, use a Snapshot instead
+class ofxEditorBuffer {
+
+	public:
+
+		ofxEditorBuffer();
+		ofxEditorBuffer(const std::u32string &text);
+		ofxEditorBuffer(const ofxEditorBuffer &from);
+		ofxEditorBuffer& operator=(const ofxEditorBuffer &from);
+		ofxEditorBuffer& operator=(const std::u32string &text);
+		virtual ~ofxEditorBuffer();
+
+		/// not found or until the end of the buffer
+		static const size_t npos = (size_t)-1;
+
+	/// \section Edit
+
+		/// replace buffer contents, the given text becomes the original text
+		void assign(const std::u32string &text);
+
+		/// replace buffer contents with len bytes of UTF-8 text decoded
+		/// straight into the original text, malformed bytes become U+FFFD
+		void assign(const char *text, size_t len);
+
+		/// replace buffer contents with a UTF-8 text file, the file is memory
+		/// mapped & decoded without reading it into an intermediate buffer,
+		/// returns false & leaves the contents unchanged if the file can't
+		/// be opened or mapped
+		bool assignFile(const std::string &path);
+
+		/// insert text at a given buffer pos, pos is clamped to the buffer size
+		void insert(size_t pos, const std::u32string &text);
+		void insert(size_t pos, const char32_t *text, size_t len);
+
+		/// append text to the end of the buffer
+		void append(const std::u32string &text);
+		ofxEditorBuffer& operator+=(const std::u32string &text);
+		ofxEditorBuffer& operator+=(char32_t c);
+
+		/// erase len chars starting at pos, len is clamped to the buffer size
+		void erase(size_t pos, size_t len=npos);
+
+		/// truncate to len chars or pad the end with c
+		void resize(size_t len, char32_t c=0);
+
+		/// clear all text & pieces
+		void clear();
+
+		/// rebuild the buffer from it's current text once more than half of
+		/// the original & add text is no longer referenced, ie. after
+		/// erasing a lot of text, the text & changes are not affected
+		void compact();
+
+		/// set a journal to record edits to or NULL to stop recording,
+		/// copies of the buffer don't record to the journal
+		void setJournal(ofxEditorJournal *journal);
+
+		/// get the current journal or NULL
+		ofxEditorJournal* getJournal();
+
+	/// \section Access
+
+		/// number of chars in the buffer
+		size_t size() const;
+		size_t length() const;
+
+		/// is the buffer empty?
+		bool empty() const;
+
+		/// get the char at pos, returns 0 if pos is out of bounds
+		char32_t at(size_t pos) const;
+		char32_t operator[](size_t pos) const;
+
+		/// get a copy of len chars starting at pos
+		std::u32string substr(size_t pos, size_t len=npos) const;
+
+		/// append len chars starting at pos to dest without clearing it,
+		/// useful for reusing a scratch string
+		void copy(std::u32string &dest, size_t pos, size_t len=npos) const;
+
+		/// append len chars starting at pos to dest as UTF-8 bytes, this
+		/// skips building an intermediate wide string
+		void copy(std::string &dest, size_t pos, size_t len=npos) const;
+
+		/// build a flat copy of the whole buffer
+		std::u32string getText() const;
+
+		/// find the first c at or after pos, returns npos if not found
+		size_t find(char32_t c, size_t pos=0) const;
+
+		/// find the last c at or before pos, returns npos if not found
+		size_t rfind(char32_t c, size_t pos=npos) const;
+
+		/// count number of c within len chars starting at pos
+		size_t count(char32_t c, size_t pos=0, size_t len=npos) const;
+
+		/// number of pieces currently in the table, useful for debugging
+		size_t getNumPieces() const;
+
+	/// \section Snapshot
+
+		/// immutable copy of the text which shares the buffer's original &
+		/// add text & only copies the piece spans, it can be read from
+		/// another thread while the buffer is edited
+		class Snapshot {
+
+			public:
+
+				Snapshot();
+
+				/// number of chars in the snapshot
+				size_t size() const;
+
+				/// append len chars starting at pos to dest as UTF-8 bytes
+				void copy(std::string &dest, size_t pos, size_t len=npos) const;
+
+				/// visit chunks of text in [pos, pos+len) in order, the
+				/// visitor is called as v(const char32_t *chunk, size_t n,
+				/// size_t chunkPos) & stops the visit by returning false,
+				/// returns false if stopped early
+				template<typename Visitor>
+				bool visit(size_t pos, size_t len, Visitor &v) const;
+
+			protected:
+
+				friend class ofxEditorBuffer;
+
+				/// span of the original or add text
+				struct Span {
+					bool added;    //< in add text? otherwise original
+					size_t start;  //< start pos in the source text
+					size_t length; //< span length in chars
+				};
+
+				std::shared_ptr<const std::u32string> m_original; //< shared original text
+				std::shared_ptr<const std::u32string> m_added;    //< shared add text
+				std::vector<Span> m_spans; //< text spans in order
+				size_t m_size; //< total chars
+		};
+
+		/// take a snapshot of the current text, only the pieces are copied so
+		/// this is O(number of pieces) instead of O(size)
+		///
+		/// the buffer copies the add text before its next insert while a
+		/// snapshot still shares it, so drop snapshots as soon as possible
+		Snapshot snapshot() const;
+
+	/// \section Lines
+
+		/// number of line breaks ('\n') in the buffer
+		/// note: number of lines is the number of line breaks + 1
+		size_t getNumLineBreaks() const;
+
+		/// get the line for a given buffer pos aka the number of line breaks
+		/// before pos, a line break belongs to the line it ends
+		size_t getLineForPos(size_t pos) const;
+
+		/// get the buffer pos of the first char in a line,
+		/// returns size() if line is past the last line
+		size_t getLineStart(size_t line) const;
+
+		/// get the buffer pos of the line break ending a line,
+		/// returns size() for the last line
+		size_t getLineEnd(size_t line) const;
+
+	/// \section Changes
+
+		/// get the range of lines changed since the last clearChanges() in
+		/// current line numbers & the net number of line breaks added (> 0) or
+		/// removed (< 0), returns false if there were no changes
+		///
+		/// lines after last are unchanged and map to line - delta before the
+		/// changes, assign() & clear() mark all lines as changed
+		bool getChangedLines(size_t &first, size_t &last, long &delta) const;
+
+		/// get the edit revision which is incremented with every change,
+		/// useful for checking if a cached result is still valid
+		size_t getRevision() const;
+	
+		/// reset change tracking, call after syncing with the buffer
+		void clearChanges();
+
+	protected:
+
+		/// piece tree node, references a span of the original or add buffer
+		struct Piece {
+			bool added;     //< in add buffer? otherwise original
+			size_t start;   //< start pos in the source buffer
+			size_t length;  //< piece length in chars
+			size_t size;    //< total chars in this subtree
+			size_t lineBreaks; //< line breaks in this piece
+			size_t totalLineBreaks; //< total line breaks in this subtree
+			unsigned int priority; //< random treap heap priority
+			Piece *left, *right;   //< children
+		};
+
+		std::shared_ptr<std::u32string> m_original; //< original text, never modified, shared with snapshots
+		std::shared_ptr<std::u32string> m_added;    //< append-only add buffer, shared with snapshots
+		std::vector<size_t> m_originalBreaks; //< sorted line break pos in original text
+		std::vector<size_t> m_addedBreaks;    //< sorted line break pos in add buffer
+		Piece *m_root; //< piece tree root
+		size_t m_numPieces; //< current number of pieces in the tree
+
+		unsigned int m_seed; //< treap priority random seed
+
+		// cached piece for fast sequential access
+		mutable const Piece *m_cachePiece; //< last accessed piece
+		mutable size_t m_cacheStart;      //< buffer pos of the cached piece
+
+		// last insert for coalescing typed chars into a single piece
+		size_t m_lastInsertEnd; //< buffer pos after the last insert or npos
+
+		// changed lines since the last clearChanges()
+		bool m_changed;          //< have there been any changes?
+		bool m_changedAll;       //< have all lines been replaced?
+		size_t m_changedFirst;   //< first changed line
+		size_t m_changedLast;    //< last changed line
+		size_t m_baseLineBreaks; //< line breaks at the last clearChanges()
+		size_t m_revision;       //< incremented with every change
+
+		ofxEditorJournal *m_journal; //< journal to record edits to or NULL
+
+		/// clear all text & pieces without recording it
+		void reset();
+
+		/// get the source text pointer for a piece
+		const char32_t* source(const Piece *p) const;
+
+		/// copy the add buffer before appending to it if a snapshot shares it
+		void detachAdded();
+
+		/// count the line breaks in a span of a piece's source buffer
+		size_t countLineBreaks(bool added, size_t start, size_t length) const;
+
+		/// append line break positions found in text to an index
+		static void indexLineBreaks(std::vector<size_t> &breaks, const char32_t *text, size_t len, size_t offset);
+
+		/// find the buffer pos of the nth line break, n starts at 1
+		size_t findLineBreak(size_t n) const;
+
+		/// add an edit at a line which removed & added line breaks to the
+		/// changed line range
+		void markChanged(size_t line, size_t removed, size_t added);
+
+		/// create a new piece node
+		Piece* createPiece(bool added, size_t start, size_t length);
+
+		/// delete a node and all of its children
+		void destroy(Piece *p);
+
+		/// next random treap priority
+		unsigned int nextPriority();
+
+		/// recompute subtree size & line breaks
+		static void update(Piece *p);
+
+		/// subtree size, 0 if NULL
+		static size_t sizeOf(const Piece *p);
+
+		/// subtree line breaks, 0 if NULL
+		static size_t lineBreaksOf(const Piece *p);
+
+		/// split tree t at buffer pos so l holds the first pos chars
+		void split(Piece *t, size_t pos, Piece *&l, Piece *&r);
+
+		/// merge two trees where all of l comes before r
+		Piece* merge(Piece *l, Piece *r);
+
+		/// find the piece containing pos and it's start pos in the buffer
+		const Piece* findPiece(size_t pos, size_t &pieceStart) const;
+
+		/// try to extend the last inserted piece, returns true on success
+		bool extendLastInsert(size_t pos, const char32_t *text, size_t len);
+
+		/// visit chunks of text in [pos, pos+len) in order, stops when
+		/// the visitor returns false, returns false if stopped early
+		template<typename Visitor>
+		bool visit(const Piece *p, size_t offset, size_t pos, size_t len, Visitor &v) const;
+
+		/// visit chunks of text in [pos, pos+len) in reverse order, stops when
+		/// the visitor returns false, returns false if stopped early
+		template<typename Visitor>
+		bool visitReverse(const Piece *p, size_t offset, size_t pos, size_t len, Visitor &v) const;
+};
+
+//--------------------------------------------------------------
+template<typename Visitor>
+bool ofxEditorBuffer::Snapshot::visit(size_t pos, size_t len, Visitor &v) const {
+	if(pos >= m_size) {
+		return true;
+	}
+	len = std::min(len, m_size-pos);
+	size_t spanPos = 0;
+	for(size_t i = 0; i < m_spans.size() && len > 0; ++i) {
+		const Span &span = m_spans[i];
+		if(pos < spanPos + span.length) {
+			size_t offset = pos - spanPos;
+			size_t n = std::min(len, span.length - offset);
+			const std::u32string &text = (span.added ? *m_added : *m_original);
+			if(!v(text.data() + span.start + offset, n, pos)) {
+				return false;
+			}
+			pos += n;
+			len -= n;
+		}
+		spanPos += span.length;
+	}
+	return true;
+}
@@ -22,6 +22,27 @@
 #include "ofLog.h"
 #include "ofUtils.h"
 #include "ofXml.h"
+#include "ofFileUtils.h"
+
+#include <cstring>
+
+// binary cache, a header & the colors as r, g, b, a bytes in member order,
+// the magic number doesn't match on a machine with another byte order
+#define CACHE_EXT     ".bin"
+#define CACHE_MAGIC   0x4358464F // "OFXC" on little endian
+#define CACHE_VERSION 1
+#define CACHE_COLORS  8
+
+/// is the cache file at least as new as the xml file?
+static inline bool cache_is_current(const std::string &xmlPath, const std::string &cachePath) {
+	std::error_code error;
+	of::filesystem::file_time_type xmlTime = of::filesystem::last_write_time(xmlPath, error);
+	if(error) {
+		return false;
+	}
+	of::filesystem::file_time_type cacheTime = of::filesystem::last_write_time(cachePath, error);
+	return !error && cacheTime >= xmlTime;
+}
 
 // COLOR SCHEME
 
@@ -40,6 +61,10 @@ ofxEditorColorScheme::ofxEditorColorScheme(const std::string& xmlFile) {
 //--------------------------------------------------------------
 bool ofxEditorColorScheme::loadFile(const std::string& xmlFile) {
 	std::string path = ofToDataPath(xmlFile);
+	std::string cachePath = path + CACHE_EXT;
+	if(cache_is_current(path, cachePath) && loadCache(cachePath)) {
+		return true;
+	}
 	ofXml xml;
 	if(!xml.load(path)) {
 		ofLogError("ofxEditorColorScheme") << "couldn't load \""
@@ -65,6 +90,7 @@ bool ofxEditorColorScheme::loadFile(const std::string& xmlFile) {
 			ofLogWarning("ofxEditorColorScheme") << "ignoring unknown xml tag \"" << child.getName() << "\"";
 		}
 	}
+	saveCache(cachePath);
 	
 	return true;
 }
@@ -183,3 +209,64 @@ void ofxEditorColorScheme::setColorFromXml(ofXml &xml, ofColor &color) {
 	if(b) {color.b = b.getIntValue();}
 	if(a) {color.a = a.getIntValue();}
 }
+
+//--------------------------------------------------------------
+bool ofxEditorColorScheme::loadCache(const std::string &path) {
+	ofFile file;
+	if(!file.open(path, ofFile::ReadOnly, true)) {
+		return false;
+	}
+	ofBuffer buffer = file.readToBuffer();
+	file.close();
+	uint32_t header[2];
+	if(buffer.size() != sizeof(header) + CACHE_COLORS*4) {
+		return false;
+	}
+	memcpy(header, buffer.getData(), sizeof(header));
+	if(header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION) {
+		ofLogVerbose("ofxEditorColorScheme") << "ignoring stale cache \""
+			<< ofFilePath::getFileName(path) << "\"";
+		return false;
+	}
+	ofColor *colors[CACHE_COLORS] = {
+		&textColor, &stringColor, &numberColor, &commentColor,
+		&preprocessorColor, &keywordColor, &typenameColor, &functionColor
+	};
+	const unsigned char *data = (const unsigned char *)buffer.getData() + sizeof(header);
+	for(int i = 0; i < CACHE_COLORS; ++i, data += 4) {
+		colors[i]->r = data[0];
+		colors[i]->g = data[1];
+		colors[i]->b = data[2];
+		colors[i]->a = data[3];
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorColorScheme::saveCache(const std::string &path) {
+	uint32_t header[2] = {CACHE_MAGIC, CACHE_VERSION};
+	unsigned char data[sizeof(header) + CACHE_COLORS*4];
+	memcpy(data, header, sizeof(header));
+	const ofColor *colors[CACHE_COLORS] = {
+		&textColor, &stringColor, &numberColor, &commentColor,
+		&preprocessorColor, &keywordColor, &typenameColor, &functionColor
+	};
+	unsigned char *color = data + sizeof(header);
+	for(int i = 0; i < CACHE_COLORS; ++i, color += 4) {
+		color[0] = colors[i]->r;
+		color[1] = colors[i]->g;
+		color[2] = colors[i]->b;
+		color[3] = colors[i]->a;
+	}
+	ofFile file;
+	if(!file.open(path, ofFile::WriteOnly, true)) {
+		ofLogVerbose("ofxEditorColorScheme") << "couldn't save cache \""
+			<< ofFilePath::getFileName(path) << "\"";
+		return false;
+	}
+	ofBuffer buffer;
+	buffer.set((const char *)data, sizeof(data));
+	bool saved = file.writeFromBuffer(buffer);
+	file.close();
+	return saved;
+}
@@ -71,6 +71,10 @@ class ofxEditorColorScheme {
 		///   </number>
 		/// </colorcheme>
 		///
+		/// the colors are saved to a binary cache next to the xml file, ie.
+		/// "colors.xml.bin", which is loaded instead as long as it is newer
+		/// than the xml file
+		///
 		/// returns false on read or parse error
 		bool loadFile(const std::string& xmlFile);
 	
@@ -122,6 +126,13 @@ class ofxEditorColorScheme {
 		/// available tags (all int values): r, g, b, a, gray, hex
 		void setColorFromXml(ofXml &xml, ofColor &color);
 	
+		/// load the colors from a binary cache file, returns false if the
+		/// file is missing, from another version, or can't be read
+		bool loadCache(const std::string &path);
+	
+		/// save the colors to a binary cache file
+		bool saveCache(const std::string &path);
+	
 		ofColor textColor;
 		ofColor stringColor;
 		ofColor numberColor;
@@ -26,6 +26,8 @@
 #include "fontstash.h"
 #define GLFONTSTASH_IMPLEMENTATION
 #include "glfontstash.h"
+#define MEMFONTSTASH_IMPLEMENTATION
+#include "memfontstash.h"
 
 #define ATLAS_MAX_SIZE 2048
 
@@ -35,7 +37,15 @@ ofxEditorFont::ofxEditorFont() {
 	font = 0;
 	size = 0;
 	lineHeight = 0;
+	headless = false;
+	monoAdvance = 0;
+	std::fill(advances, advances+256, 0);
 	textShadowColor = glfonsRGBA(0, 0, 0, 255); // black
+	batching = false;
+	atlasWidth = atlasHeight = 0;
+	atlasId = 0;
+	capturing = false;
+	captureShadow = captureGlyph = 0;
 }
 
 //--------------------------------------------------------------
@@ -44,20 +54,27 @@ ofxEditorFont::~ofxEditorFont() {
 }
 
 //--------------------------------------------------------------
-bool ofxEditorFont::load(std::string filename, int fontsize, int textureDimension) {
+bool ofxEditorFont::load(std::string filename, int fontsize, int textureDimension, bool headless) {
 	
 	clear();
 	
 	textureDimension = ofNextPow2(textureDimension);
-	context = glfonsCreate(textureDimension, textureDimension, FONS_ZERO_TOPLEFT);
+	if(headless) {
+		context = memfonsCreate(textureDimension, textureDimension, FONS_ZERO_TOPLEFT);
+	}
+	else {
+		context = glfonsCreate(textureDimension, textureDimension, FONS_ZERO_TOPLEFT);
+	}
+	if(!context) {
+		ofLogError("ofxEditorFont") << "couldn't create font context";
+		return false;
+	}
+	this->headless = headless;
 	
 	font = fonsAddFont(context, "normal", ofToDataPath(filename).c_str());
 	if(font == FONS_INVALID) {
 		ofLogError("ofxEditorFont") << "couldn't load font: " << filename;
-		if(context) {
-			glfonsDelete(context);
-		}
-		context = NULL;
+		clear();
 		return false;
 	}
 	size = fontsize;
@@ -66,6 +83,12 @@ bool ofxEditorFont::load(std::string filename, int fontsize, int textureDimensio
 	fonsSetColor(context, glfonsRGBA(255, 255, 255, 255)); // white
 	fonsVertMetrics(context, NULL, NULL, &lineHeight);
 	fonsSetErrorCallback(context, ofxEditorFont::stashError, context);
+	fonsGetAtlasSize(context, &atlasWidth, &atlasHeight);
+	cacheAdvances();
+	
+	// invalidate geometry captured with a previous atlas
+	static unsigned int s_atlasCount = 0;
+	atlasId = ++s_atlasCount;
 	
 	return true;
 }
@@ -75,15 +98,34 @@ bool ofxEditorFont::isLoaded() {
 	return context != NULL;
 }
 
+//--------------------------------------------------------------
+bool ofxEditorFont::isHeadless() {
+	return headless;
+}
+
 //--------------------------------------------------------------
 void ofxEditorFont::clear() {
 	if(context) {
-		glfonsDelete(context);
+		if(headless) {
+			memfonsDelete(context);
+		}
+		else {
+			glfonsDelete(context);
+		}
 	}
+	shadows.clear();
+	glyphs.clear();
+	batching = false;
+	capturing = false;
+	atlasId = 0;
 	context = NULL;
 	font = 0;
 	size = 0;
 	lineHeight = 0;
+	headless = false;
+	monoAdvance = 0;
+	std::fill(advances, advances+256, 0);
+	advanceMap.clear();
 }
 
 //--------------------------------------------------------------
@@ -98,17 +140,58 @@ float ofxEditorFont::getLineHeight() {
 
 //--------------------------------------------------------------
 float ofxEditorFont::characterWidth(int c) {
-	return fonsTextBounds(context, 0, 0, wchar_to_string(c).c_str(), NULL, NULL);
+	if(c >= 0 && c < 256) {
+		return advances[c];
+	}
+	std::unordered_map<unsigned int, float>::iterator iter = advanceMap.find(c);
+	if(iter != advanceMap.end()) {
+		return iter->second;
+	}
+	float advance = glyphAdvance(c);
+	if(context) {
+		advanceMap[c] = advance;
+	}
+	return advance;
 }
 
 //--------------------------------------------------------------
 float ofxEditorFont::stringWidth(const std::string& s) {
-	return fonsTextBounds(context, 0, 0, s.c_str(), NULL, NULL);
+	
+	// ASCII only? all chars have the same width
+	if(monoAdvance > 0) {
+		size_t i = 0;
+		for(; i < s.size(); ++i) {
+			if((unsigned char)s[i] < 0x20 || (unsigned char)s[i] > 0x7E) {
+				break;
+			}
+		}
+		if(i == s.size()) {
+			return monoAdvance * s.size();
+		}
+	}
+	
+	float width = 0;
+	unsigned int state = 0, codepoint = 0;
+	for(size_t i = 0; i < s.size(); ++i) {
+		if(fons__decutf8(&state, &codepoint, (unsigned char)s[i]) == FONS_UTF8_ACCEPT) {
+			width += characterWidth(codepoint);
+		}
+	}
+	return width;
 }
 
 //--------------------------------------------------------------
 float ofxEditorFont::stringWidth(const std::u32string& s) {
-	return stringWidth(wstring_to_string(s));
+	float width = 0;
+	for(size_t i = 0; i < s.size(); ++i) {
+		width += characterWidth(s[i]);
+	}
+	return width;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorFont::isMonospace() {
+	return monoAdvance > 0;
 }
 
 //--------------------------------------------------------------
@@ -120,35 +203,103 @@ float ofxEditorFont::stringHeight(const std::string& s) {
 
 //--------------------------------------------------------------
 float ofxEditorFont::stringHeight(const std::u32string& s) {
-	return stringHeight(wstring_to_string(s));
+	utf8.clear();
+	wstring_append(utf8, s);
+	return stringHeight(utf8);
 }
 
 //--------------------------------------------------------------
 float ofxEditorFont::drawCharacter(int c, float x, float y, bool shadowed) {
-	string s = wchar_to_string(c);
-	if(shadowed) {
-		fonsPushState(context);
-		fonsSetColor(context, textShadowColor);
-		fonsDrawText(context, x+1, y+1, s.c_str(), NULL);
-		fonsPopState(context);
+	x = addCharacter(c, x, y, shadowed);
+	if(!batching) {
+		flush();
 	}
-	return fonsDrawText(context, x, y, s.c_str(), NULL);
+	return x;
 }
 
 //--------------------------------------------------------------
 float ofxEditorFont::drawString(const std::string& s, float x, float y, bool shadowed) {
-	if(shadowed) {
-		fonsPushState(context);
-		fonsSetColor(context, textShadowColor);
-		fonsDrawText(context, x+1, y+1, s.c_str(), NULL);
-		fonsPopState(context);
-	}
-	return fonsDrawText(context, x, y, s.c_str(), NULL);
+	// convert so the glyphs go through the batch like the wide char strings
+	wide.clear();
+	string_append(wide, s);
+	return drawRun(wide.data(), wide.size(), x, y, shadowed);
 }
 
 //--------------------------------------------------------------
 float ofxEditorFont::drawString(const std::u32string& s, float x, float y, bool shadowed) {
-	return drawString(wstring_to_string(s), x, y, shadowed);
+	return drawRun(s.data(), s.size(), x, y, shadowed);
+}
+
+//--------------------------------------------------------------
+float ofxEditorFont::drawRun(const char32_t *text, size_t len, float x, float y, bool shadowed) {
+	for(size_t i = 0; i < len; ++i) {
+		x = addCharacter(text[i], x, y, shadowed);
+	}
+	if(!batching) {
+		flush();
+	}
+	return x;
+}
+
+// BATCHED DRAWING
+
+//--------------------------------------------------------------
+void ofxEditorFont::beginBatch() {
+	batching = true;
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::endBatch() {
+	batching = false;
+	capturing = false;
+	flush();
+}
+
+//--------------------------------------------------------------
+bool ofxEditorFont::isBatching() {
+	return batching;
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::beginCapture() {
+	if(!batching) {
+		return;
+	}
+	capturing = true;
+	captureShadow = shadows.colors.size();
+	captureGlyph = glyphs.colors.size();
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::endCapture(Geometry &geometry, float x, float y) {
+	geometry.clear();
+	if(!capturing) {
+		return;
+	}
+	copyVertices(geometry.shadows, shadows, captureShadow, x, y);
+	copyVertices(geometry.glyphs, glyphs, captureGlyph, x, y);
+	geometry.atlasId = atlasId;
+	geometry.atlasWidth = atlasWidth;
+	geometry.atlasHeight = atlasHeight;
+	capturing = false;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorFont::drawGeometry(const Geometry &geometry, float x, float y) {
+	if(!batching || !context || geometry.atlasId != atlasId) {
+		return false;
+	}
+	
+	// the atlas only grows & keeps existing glyphs in place,
+	// so tex coords just need to be rescaled if it was expanded since
+	float sx = 1, sy = 1;
+	if(geometry.atlasWidth != atlasWidth || geometry.atlasHeight != atlasHeight) {
+		sx = (float)geometry.atlasWidth/atlasWidth;
+		sy = (float)geometry.atlasHeight/atlasHeight;
+	}
+	appendVertices(shadows, geometry.shadows, x, y, sx, sy);
+	appendVertices(glyphs, geometry.glyphs, x, y, sx, sy);
+	return true;
 }
 
 //--------------------------------------------------------------
@@ -162,6 +313,19 @@ void ofxEditorFont::setShadowColor(ofColor &c, float alpha) {
 	textShadowColor = glfonsRGBA(c.r, c.g, c.b, c.a*alpha);
 }
 
+//--------------------------------------------------------------
+unsigned int ofxEditorFont::getPackedColor() {
+	if(!context) {
+		return glfonsRGBA(255, 255, 255, 255);
+	}
+	return fons__getState(context)->color;
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::setPackedColor(unsigned int color) {
+	fonsSetColor(context, color);
+}
+
 //--------------------------------------------------------------
 void ofxEditorFont::pushState() {
 	fonsPushState(context);
@@ -172,8 +336,245 @@ void ofxEditorFont::popState() {
 	fonsPopState(context);
 }
 
+// HEADLESS
+
+//--------------------------------------------------------------
+const unsigned char* ofxEditorFont::getAtlasPixels(int &width, int &height) {
+	if(!context || !headless) {
+		width = height = 0;
+		return NULL;
+	}
+	return memfonsGetAtlas(context, &width, &height);
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::setRecording(bool record) {
+	if(!context || !headless) {
+		return;
+	}
+	memfonsSetRecording(context, record);
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorFont::getRecordedVertices(const float **verts, const float **tcoords, const unsigned int **colors) {
+	if(!context || !headless) {
+		return 0;
+	}
+	return memfonsGetVertices(context, verts, tcoords, colors);
+}
+
+//--------------------------------------------------------------
+bool ofxEditorFont::getDrawStats(size_t &draws, size_t &vertices) {
+	if(!context || !headless) {
+		draws = vertices = 0;
+		return false;
+	}
+	int d, v;
+	memfonsGetDrawStats(context, &d, &v);
+	draws = d;
+	vertices = v;
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::clearRecording() {
+	if(!context || !headless) {
+		return;
+	}
+	memfonsClear(context);
+}
+
 // PRIVATE
 
+//--------------------------------------------------------------
+void ofxEditorFont::Vertices::clear() {
+	verts.clear();
+	tcoords.clear();
+	colors.clear();
+}
+
+//--------------------------------------------------------------
+bool ofxEditorFont::Vertices::empty() const {
+	return colors.empty();
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::Geometry::clear() {
+	shadows.clear();
+	glyphs.clear();
+	atlasId = 0;
+	atlasWidth = atlasHeight = 0;
+}
+
+//--------------------------------------------------------------
+float ofxEditorFont::glyphAdvance(unsigned int c) {
+	if(!context) {
+		return 0;
+	}
+	FONSstate *state = fons__getState(context);
+	if(state->font < 0 || state->font >= context->nfonts) {
+		return 0;
+	}
+	FONSfont *f = context->fonts[state->font];
+	if(f->data == NULL) {
+		return 0;
+	}
+	
+	// same rounding as fons__getGlyph & fons__getQuad
+	short isize = (short)(state->size*10.0f);
+	float scale = fons__tt_getPixelHeightScale(&f->font, (float)isize/10.0f);
+	int advance = 0, lsb, x0, y0, x1, y1;
+	int g = fons__tt_getGlyphIndex(&f->font, c);
+	if(!fons__tt_buildGlyphBitmap(&f->font, g, (float)isize/10.0f, scale,
+	                              &advance, &lsb, &x0, &y0, &x1, &y1)) {
+		return 0;
+	}
+	short xadv = (short)(scale * advance * 10.0f);
+	return (int)(xadv / 10.0f + 0.5f);
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::cacheAdvances() {
+	advanceMap.clear();
+	for(unsigned int c = 0; c < 256; ++c) {
+		advances[c] = glyphAdvance(c);
+	}
+	monoAdvance = advances[' '];
+	for(unsigned int c = 0x21; c < 0x7F; ++c) {
+		if(advances[c] != monoAdvance) {
+			monoAdvance = 0;
+			break;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+float ofxEditorFont::addCharacter(unsigned int c, float x, float y, bool shadowed) {
+	if(!context) {
+		return x;
+	}
+	FONSstate *state = fons__getState(context);
+	if(state->font < 0 || state->font >= context->nfonts) {
+		return x;
+	}
+	FONSfont *f = context->fonts[state->font];
+	if(f->data == NULL) {
+		return x;
+	}
+	short isize = (short)(state->size*10.0f);
+	short iblur = (short)state->blur;
+	float scale = fons__tt_getPixelHeightScale(&f->font, (float)isize/10.0f);
+	y += fons__getVertAlign(context, f, state->align, isize);
+	
+	FONSglyph *glyph = fons__getGlyph(context, f, c, isize, iblur);
+	if(glyph == NULL) {
+		return x;
+	}
+	
+	// atlas expanded when adding the glyph? rescale collected tex coords
+	if(context->params.width != atlasWidth || context->params.height != atlasHeight) {
+		float sx = (float)atlasWidth/context->params.width;
+		float sy = (float)atlasHeight/context->params.height;
+		Vertices *all[2] = {&shadows, &glyphs};
+		for(int v = 0; v < 2; ++v) {
+			std::vector<float> &tcoords = all[v]->tcoords;
+			for(size_t i = 0; i < tcoords.size(); i += 2) {
+				tcoords[i] *= sx;
+				tcoords[i+1] *= sy;
+			}
+		}
+		atlasWidth = context->params.width;
+		atlasHeight = context->params.height;
+	}
+	
+	// no kerning, chars are placed individually
+	FONSquad q;
+	if(shadowed) {
+		float sx = x+1, sy = y+1;
+		fons__getQuad(context, f, -1, glyph, scale, state->spacing, &sx, &sy, &q);
+		addQuad(shadows, q, textShadowColor);
+	}
+	fons__getQuad(context, f, -1, glyph, scale, state->spacing, &x, &y, &q);
+	addQuad(glyphs, q, state->color);
+	
+	return x;
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::addQuad(Vertices &v, const FONSquad &q, unsigned int color) {
+	const float verts[12] = {
+		q.x0, q.y0, q.x1, q.y1, q.x1, q.y0,
+		q.x0, q.y0, q.x0, q.y1, q.x1, q.y1
+	};
+	const float tcoords[12] = {
+		q.s0, q.t0, q.s1, q.t1, q.s1, q.t0,
+		q.s0, q.t0, q.s0, q.t1, q.s1, q.t1
+	};
+	v.verts.insert(v.verts.end(), verts, verts+12);
+	v.tcoords.insert(v.tcoords.end(), tcoords, tcoords+12);
+	v.colors.insert(v.colors.end(), 6, color);
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::copyVertices(Vertices &to, const Vertices &from, size_t start, float x, float y) {
+	if(start > from.colors.size()) {
+		start = from.colors.size();
+	}
+	to.verts.assign(from.verts.begin()+start*2, from.verts.end());
+	to.tcoords.assign(from.tcoords.begin()+start*2, from.tcoords.end());
+	to.colors.assign(from.colors.begin()+start, from.colors.end());
+	for(size_t i = 0; i < to.verts.size(); i += 2) {
+		to.verts[i] -= x;
+		to.verts[i+1] -= y;
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::appendVertices(Vertices &to, const Vertices &from, float x, float y, float sx, float sy) {
+	size_t start = to.verts.size();
+	to.verts.insert(to.verts.end(), from.verts.begin(), from.verts.end());
+	to.tcoords.insert(to.tcoords.end(), from.tcoords.begin(), from.tcoords.end());
+	to.colors.insert(to.colors.end(), from.colors.begin(), from.colors.end());
+	for(size_t i = start; i < to.verts.size(); i += 2) {
+		to.verts[i] += x;
+		to.verts[i+1] += y;
+		if(sx != 1 || sy != 1) {
+			to.tcoords[i] *= sx;
+			to.tcoords[i+1] *= sy;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditorFont::flush() {
+	if(!context || glyphs.colors.empty()) {
+		return;
+	}
+	if(context->params.renderDraw == NULL) {
+		shadows.clear();
+		glyphs.clear();
+		return;
+	}
+	
+	// update the atlas texture with any new glyphs
+	fons__flush(context);
+	
+	// shadows are drawn first, so draw everything in one go
+	if(!shadows.colors.empty()) {
+		shadows.verts.insert(shadows.verts.end(), glyphs.verts.begin(), glyphs.verts.end());
+		shadows.tcoords.insert(shadows.tcoords.end(), glyphs.tcoords.begin(), glyphs.tcoords.end());
+		shadows.colors.insert(shadows.colors.end(), glyphs.colors.begin(), glyphs.colors.end());
+		context->params.renderDraw(context->params.userPtr, shadows.verts.data(),
+			shadows.tcoords.data(), shadows.colors.data(), shadows.colors.size());
+	}
+	else {
+		context->params.renderDraw(context->params.userPtr, glyphs.verts.data(),
+			glyphs.tcoords.data(), glyphs.colors.data(), glyphs.colors.size());
+	}
+	shadows.clear();
+	glyphs.clear();
+}
+
 //--------------------------------------------------------------
 void ofxEditorFont::stashError(void* uptr, int error, int val) {
 	(void)uptr;
@@ -23,6 +23,9 @@
 #include "ofColor.h"
 #include "fontstash.h"
 
+#include <vector>
+#include <unordered_map>
+
 /// fontstash library wrapper for efficient text rendering since ofTrueTypeFont
 /// is too slow for lots of chars, this may change in the future as the new
 /// ofFont & unicode support are integrated into OpenFrameworks
@@ -30,24 +33,59 @@
 /// supports UTF8 but is dependent on what glyphs the loaded font supports,
 /// unknown glyphs are simply rendered as spaces
 ///
+/// drawing can be batched between beginBatch() & endBatch() so glyph quads are
+/// collected instead of drawn right away, this renders a whole screen of text
+/// with a single draw call instead of one or two per char
+///
+/// the quads added during a batch can also be captured into a Geometry and
+/// redrawn later at an offset, this skips glyph lookups & layout for text which
+/// has not changed between frames
+///
+/// a headless font keeps the atlas in memory & counts draw calls instead of
+/// rendering with GL, useful for testing & benchmarking without a GPU
+///
 /// note: don't use this directly, requires alpha blending to avoid per-char
 ///       style & color pushes & pops
 class ofxEditorFont {
 
 	public:
 	
+		/// collected glyph quad vertices
+		struct Vertices {
+			std::vector<float> verts;         //< x & y pairs
+			std::vector<float> tcoords;       //< s & t pairs
+			std::vector<unsigned int> colors; //< RGBA colors
+			void clear();
+			bool empty() const;
+		};
+	
+		/// captured glyph quads, positions are relative to the capture origin
+		struct Geometry {
+			Vertices shadows;     //< captured shadow quads
+			Vertices glyphs;      //< captured char quads
+			unsigned int atlasId; //< atlas the tex coords refer to
+			int atlasWidth;       //< atlas size the tex coords are based on
+			int atlasHeight;
+			Geometry() : atlasId(0), atlasWidth(0), atlasHeight(0) {}
+			void clear();
+		};
+	
 		ofxEditorFont();
 		virtual ~ofxEditorFont();
 	
 	/// \section Main
 	
 		/// create a fonstash context and load a given font
+		/// set headless=true to render into memory without a GL context
 		/// returns false if the font could not be loaded
-		bool load(std::string filename, int fontsize, int textureDimension = 512);
+		bool load(std::string filename, int fontsize, int textureDimension = 512, bool headless = false);
 	
 		/// returns true if the fonstash context exists (aka font is loaded)
 		bool isLoaded();
 	
+		/// returns true if the font was loaded headless
+		bool isHeadless();
+	
 		/// clear the font & fonstash context
 		void clear();
 	
@@ -59,13 +97,17 @@ class ofxEditorFont {
 		/// get the calculated font line height (vertical distance to next line)
 		float getLineHeight();
 	
-		/// get the width for a given char
+		/// get the advance width for a given char
 		float characterWidth(int c);
 	
-		/// get bounding box width for a given string
+		/// get the advance width for a given string, this is the sum of the
+		/// char widths as chars are drawn without kerning
 		float stringWidth(const std::string& s);
 		float stringWidth(const std::u32string& s);
 	
+		/// returns true if all printable ASCII chars have the same width
+		bool isMonospace();
+	
 		/// get bounding box height for a given string (single line only)
         float stringHeight(const std::string& s);
 		float stringHeight(const std::u32string& s);
@@ -87,6 +129,36 @@ class ofxEditorFont {
 		/// returns new x position
 		float drawString(const std::u32string& s, float x, float y, bool shadowed=false);
 	
+		/// draw a run of len wide chars using the current state color
+		/// set shadowed=true to draw an offset shadow using the shadow color
+		/// returns new x position
+		float drawRun(const char32_t *text, size_t len, float x, float y, bool shadowed=false);
+	
+	/// \section Batched Drawing
+	
+		/// begin collecting glyph quads instead of drawing them right away,
+		/// draw positions are not affected
+		void beginBatch();
+	
+		/// draw collected glyph quads, all shadows first and then all chars
+		void endBatch();
+	
+		/// are glyph quads being collected?
+		bool isBatching();
+	
+		/// start capturing the quads added to the current batch,
+		/// does nothing if not batching
+		void beginCapture();
+	
+		/// stop capturing & copy the captured quads into geometry relative
+		/// to the given origin, geometry is cleared if not capturing
+		void endCapture(Geometry &geometry, float x, float y);
+	
+		/// add captured quads to the current batch at the given origin,
+		/// returns false if not batching or the glyphs are no longer valid
+		/// (font reloaded) and geometry needs to be captured again
+		bool drawGeometry(const Geometry &geometry, float x, float y);
+	
 	/// \section Color & State
 	
 		/// set current state color, default: white
@@ -95,20 +167,87 @@ class ofxEditorFont {
 		/// set cached shadow color (not affected by state push/pop), default: black
 		void setShadowColor(ofColor &c, float alpha=1.0);
 	
+		/// get current state color as packed RGBA
+		unsigned int getPackedColor();
+	
+		/// set current state color from packed RGBA, ie. to restore a color
+		/// returned by getPackedColor()
+		void setPackedColor(unsigned int color);
+	
 		// push current font state (color)
 		void pushState();
 	
 		// pop current font state (color)
 		void popState();
 	
+	/// \section Headless
+	
+		/// get the in-memory atlas bitmap, 1 alpha byte per pixel,
+		/// returns NULL if not headless
+		const unsigned char* getAtlasPixels(int &width, int &height);
+	
+		/// enable/disable recording drawn vertices when headless, default: false
+		void setRecording(bool record);
+	
+		/// get the vertices recorded since the last clearRecording(),
+		/// 6 per glyph quad, returns the number of vertices or 0 if not headless
+		size_t getRecordedVertices(const float **verts, const float **tcoords, const unsigned int **colors);
+	
+		/// get the number of draw calls & drawn vertices since the last
+		/// clearRecording(), returns false if not headless
+		bool getDrawStats(size_t &draws, size_t &vertices);
+	
+		/// clear recorded vertices & draw stats
+		void clearRecording();
+	
 	private:
 	
 		struct FONScontext *context; //< fontstash context
 		int font;         //< loaded font id
 		int size;         //< requested font size
 		float lineHeight; //< computed line height
+		bool headless;    //< using the memory renderer?
+		
+		float advances[256]; //< char widths for ASCII & Latin-1, set on load
+		std::unordered_map<unsigned int, float> advanceMap; //< other char widths
+		std::string utf8;    //< reused UTF-8 conversion buffer
+		std::u32string wide; //< reused wide char conversion buffer
+		float monoAdvance;   //< printable ASCII char width if monospace, else 0
 		
 		unsigned int textShadowColor; //< cached text shadow color
+		
+		bool batching;      //< collecting quads for a batch?
+		Vertices shadows;   //< collected shadow quads
+		Vertices glyphs;    //< collected char quads
+		int atlasWidth;     //< atlas size the collected tex coords are based on
+		int atlasHeight;
+		unsigned int atlasId; //< changes whenever a new atlas is created
+		
+		bool capturing;       //< capturing collected quads?
+		size_t captureShadow; //< start of the captured shadow vertices
+		size_t captureGlyph;  //< start of the captured char vertices
+		
+		/// copy the vertices from a given vertex on, offset by -x & -y
+		static void copyVertices(Vertices &to, const Vertices &from, size_t start, float x, float y);
+		
+		/// append vertices offset by x & y, tex coords are scaled by sx & sy
+		static void appendVertices(Vertices &to, const Vertices &from, float x, float y, float sx, float sy);
+		
+		/// compute the width of a codepoint from the font metrics without
+		/// rendering the glyph
+		float glyphAdvance(unsigned int c);
+		
+		/// fill the ASCII & Latin-1 char width table
+		void cacheAdvances();
+		
+		/// add the quads for a single codepoint, returns new x position
+		float addCharacter(unsigned int c, float x, float y, bool shadowed);
+		
+		/// add a glyph quad as 2 triangles
+		static void addQuad(Vertices &v, const FONSquad &q, unsigned int color);
+		
+		/// draw & clear collected quads
+		void flush();
 	
 		/// static C error handler
 		static void stashError(void* uptr, int error, int val);
@@ -0,0 +1,622 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#include "ofxEditorJournal.h"
+#include "ofxEditorBuffer.h"
+#include "ofxEditorUndo.h"
+#include "Unicode.h"
+#include "ofLog.h"
+#include "ofFileUtils.h"
+
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <io.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// journal file header, native byte order
+#define JOURNAL_MAGIC   0x4A58464F // "OFXJ"
+#define JOURNAL_VERSION 1
+
+// how often the writer thread writes & syncs pending records
+#define JOURNAL_SYNC_MS 250
+
+// record header: payload size & type, followed by the payload & checksum
+#define RECORD_HEADER_SIZE   (sizeof(uint64_t) + 1)
+#define RECORD_CHECKSUM_SIZE sizeof(uint32_t)
+
+/// FNV-1a checksum of a span of bytes
+static inline uint32_t journal_checksum(const char *data, size_t size) {
+	uint32_t hash = 2166136261u;
+	for(size_t i = 0; i < size; ++i) {
+		hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+	}
+	return hash;
+}
+
+/// append a value to a record
+template<typename T>
+static inline void journal_write(std::string &out, T value) {
+	out.append((const char *)&value, sizeof(value));
+}
+
+/// append a length prefixed wide string to a record as UTF-8
+static inline void journal_write(std::string &out, const char32_t *text, size_t len) {
+	size_t start = out.size();
+	journal_write(out, (uint64_t)0);
+	wstring_append(out, text, len);
+	uint64_t bytes = out.size() - start - sizeof(uint64_t);
+	memcpy(&out[start], &bytes, sizeof(bytes));
+}
+
+/// append a length prefixed wide string to a record as UTF-8
+static inline void journal_write(std::string &out, const std::u32string &text) {
+	journal_write(out, text.data(), text.size());
+}
+
+/// start a record of a given type, returns the record start
+static inline size_t record_begin(std::string &out, ofxEditorJournal::RecordType type) {
+	size_t start = out.size();
+	journal_write(out, (uint64_t)0);
+	journal_write(out, (uint8_t)type);
+	return start;
+}
+
+/// finish a record with it's payload size & checksum, returns the record size
+static inline size_t record_end(std::string &out, size_t start) {
+	uint64_t size = out.size() - start - RECORD_HEADER_SIZE;
+	memcpy(&out[start], &size, sizeof(size));
+	journal_write(out, journal_checksum(out.data() + start, out.size() - start));
+	return out.size() - start;
+}
+
+/// read size bytes from a record at pos, advances pos, returns false if the
+/// record is too short
+static inline bool journal_read(const char *in, size_t inSize, size_t &pos, void *dest, size_t size) {
+	if(size > inSize - pos) {
+		return false;
+	}
+	memcpy(dest, in + pos, size);
+	pos += size;
+	return true;
+}
+
+/// read a value from a record
+template<typename T>
+static inline bool journal_read(const char *in, size_t inSize, size_t &pos, T &value) {
+	return journal_read(in, inSize, pos, &value, sizeof(value));
+}
+
+/// read a length prefixed UTF-8 string from a record as a wide string
+static inline bool journal_read(const char *in, size_t inSize, size_t &pos, std::u32string &text) {
+	uint64_t bytes;
+	if(!journal_read(in, inSize, pos, bytes) || bytes > inSize - pos) {
+		return false;
+	}
+	text.clear();
+	string_append(text, in + pos, bytes);
+	pos += bytes;
+	return true;
+}
+
+/// flush & sync a file to disk, returns false on error
+static inline bool file_sync(FILE *file) {
+	if(fflush(file) != 0) {
+		return false;
+	}
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+/// atomically replace a file with another, returns false on error
+static inline bool file_replace(const std::string &from, const std::string &to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if(rename(from.c_str(), to.c_str()) != 0) {
+		return false;
+	}
+
+	// sync the parent dir so the rename itself survives a crash
+	std::string dir = ofFilePath::getEnclosingDirectory(to, false);
+	int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+	if(fd >= 0) {
+		fsync(fd);
+		close(fd);
+	}
+	return true;
+#endif
+}
+
+/// apply a record to a buffer & undo history, returns false if the record
+/// is malformed
+static bool journal_apply(int type, const char *in, size_t size, ofxEditorBuffer &text, ofxEditorUndo &undo) {
+	size_t pos = 0;
+	switch(type) {
+		case ofxEditorJournal::CHECKPOINT: {
+			uint64_t undoSize;
+			if(!journal_read(in, size, pos, undoSize) || undoSize > size - pos ||
+			   !undo.load(in + pos, undoSize)) {
+				return false;
+			}
+			pos += undoSize;
+			text.assign(in + pos, size - pos);
+			return true;
+		}
+		case ofxEditorJournal::TEXT_INSERT: {
+			uint64_t at;
+			std::u32string inserted;
+			if(!journal_read(in, size, pos, at) || !journal_read(in, size, pos, inserted)) {
+				return false;
+			}
+			text.insert(at, inserted);
+			return true;
+		}
+		case ofxEditorJournal::TEXT_ERASE: {
+			uint64_t at, len;
+			if(!journal_read(in, size, pos, at) || !journal_read(in, size, pos, len)) {
+				return false;
+			}
+			text.erase(at, len);
+			return true;
+		}
+		case ofxEditorJournal::TEXT_CLEAR:
+			text.clear();
+			return true;
+		case ofxEditorJournal::UNDO_ADD: {
+			int32_t actionType;
+			uint32_t at;
+			std::u32string insertText, deleteText;
+			if(!journal_read(in, size, pos, actionType) || !journal_read(in, size, pos, at) ||
+			   !journal_read(in, size, pos, insertText) || !journal_read(in, size, pos, deleteText)) {
+				return false;
+			}
+			undo.add(actionType, at, insertText, deleteText, 0);
+			return true;
+		}
+		case ofxEditorJournal::UNDO_APPEND_INSERT:
+		case ofxEditorJournal::UNDO_APPEND_DELETE: {
+			std::u32string appended;
+			if(!journal_read(in, size, pos, appended)) {
+				return false;
+			}
+			if(type == ofxEditorJournal::UNDO_APPEND_INSERT) {
+				undo.appendInsertText(appended);
+			}
+			else {
+				undo.appendDeleteText(appended);
+			}
+			return true;
+		}
+		case ofxEditorJournal::UNDO_PREPEND_DELETE: {
+			std::u32string prepended;
+			uint32_t at;
+			if(!journal_read(in, size, pos, prepended) || !journal_read(in, size, pos, at)) {
+				return false;
+			}
+			undo.prependDeleteText(prepended, at);
+			return true;
+		}
+		case ofxEditorJournal::UNDO_TRIM: {
+			uint64_t maxBytes, maxActions;
+			if(!journal_read(in, size, pos, maxBytes) || !journal_read(in, size, pos, maxActions)) {
+				return false;
+			}
+			undo.trim(maxBytes, maxActions);
+			return true;
+		}
+		case ofxEditorJournal::UNDO_CLEAR:
+			undo.clear();
+			return true;
+		case ofxEditorJournal::UNDO_UNDO:
+			undo.undo();
+			return true;
+		case ofxEditorJournal::UNDO_REDO:
+			undo.redo();
+			return true;
+		case ofxEditorJournal::UNDO_SWITCH_BRANCH: {
+			uint8_t older;
+			if(!journal_read(in, size, pos, older)) {
+				return false;
+			}
+			undo.switchBranch(older != 0);
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+//--------------------------------------------------------------
+ofxEditorJournal::ofxEditorJournal() {
+	m_file = NULL;
+	m_maxBytes = 4*1024*1024;
+	m_bytes = 0;
+	m_checkpointBytes = 0;
+	m_replaced = false;
+	m_checkpoint = NULL;
+	m_running = false;
+	m_failed = false;
+}
+
+//--------------------------------------------------------------
+ofxEditorJournal::~ofxEditorJournal() {
+	close();
+}
+
+// JOURNAL
+
+//--------------------------------------------------------------
+void ofxEditorJournal::open(const std::string &path) {
+	close();
+	m_path = path;
+	m_bytes = 0;
+	m_checkpointBytes = 0;
+	m_replaced = true; // nothing to append to until the first checkpoint
+	m_failed = false;
+	m_running = true;
+	m_thread = std::thread(&ofxEditorJournal::run, this);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::close() {
+	if(!m_thread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_condition.notify_one();
+	m_thread.join();
+	if(m_file) {
+		fclose(m_file);
+		m_file = NULL;
+	}
+	m_path.clear();
+}
+
+//--------------------------------------------------------------
+bool ofxEditorJournal::isOpen() const {
+	return m_thread.joinable();
+}
+
+//--------------------------------------------------------------
+const std::string& ofxEditorJournal::getPath() const {
+	return m_path;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorJournal::replay(const std::string &path, ofxEditorBuffer &text, ofxEditorUndo &undo) {
+	ofBuffer in = ofBufferFromFile(path, true);
+	const char *data = in.getData();
+	size_t size = in.size();
+	size_t pos = 0;
+	uint32_t magic = 0, version = 0;
+	if(!journal_read(data, size, pos, magic) || !journal_read(data, size, pos, version) ||
+	   magic != JOURNAL_MAGIC || version != JOURNAL_VERSION) {
+		ofLogError("ofxEditorJournal") << "couldn't read journal \""
+			<< ofFilePath::getFileName(path) << "\"";
+		return false;
+	}
+	size_t numRecords = 0;
+	while(pos < size) {
+		uint64_t payloadSize = 0;
+		uint8_t type = 0;
+		size_t start = pos;
+		if(!journal_read(data, size, pos, payloadSize) || !journal_read(data, size, pos, type) ||
+		   payloadSize > size - pos || RECORD_CHECKSUM_SIZE > size - pos - payloadSize) {
+			ofLogWarning("ofxEditorJournal") << "ignoring partial record at the end of \""
+				<< ofFilePath::getFileName(path) << "\"";
+			break;
+		}
+		const char *payload = data + pos;
+		pos += payloadSize;
+		uint32_t checksum;
+		journal_read(data, size, pos, checksum);
+		if(checksum != journal_checksum(data + start, RECORD_HEADER_SIZE + payloadSize) ||
+		   (numRecords == 0 && type != CHECKPOINT) ||
+		   !journal_apply(type, payload, payloadSize, text, undo)) {
+			ofLogWarning("ofxEditorJournal") << "ignoring corrupt records at the end of \""
+				<< ofFilePath::getFileName(path) << "\"";
+			break;
+		}
+		numRecords++;
+	}
+	ofLogVerbose("ofxEditorJournal") << "replayed " << numRecords << " records from \""
+		<< ofFilePath::getFileName(path) << "\"";
+	return true;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorJournal::needsCheckpoint() const {
+	return isOpen() && (m_replaced || m_failed ||
+	                    m_bytes > std::max(m_maxBytes, m_checkpointBytes));
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::checkpoint(const ofxEditorBuffer &text, const ofxEditorUndo &undo) {
+	if(!isOpen()) {
+		return;
+	}
+	ofxEditorBuffer::Snapshot *snapshot = new ofxEditorBuffer::Snapshot(text.snapshot());
+	std::string undoData;
+	undo.save(undoData);
+	m_checkpointBytes = text.size() + undoData.size();
+	m_bytes = 0;
+	m_replaced = false;
+	m_failed = false;
+	{
+		// edits so far are part of the checkpoint
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.clear();
+		delete m_checkpoint;
+		m_checkpoint = snapshot;
+		m_checkpointUndo.swap(undoData);
+	}
+	m_condition.notify_one();
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::setMaxBytes(size_t bytes) {
+	m_maxBytes = bytes;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorJournal::getMaxBytes() const {
+	return m_maxBytes;
+}
+
+// TEXT BUFFER RECORDS
+
+//--------------------------------------------------------------
+void ofxEditorJournal::insert(size_t pos, const char32_t *text, size_t len) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, TEXT_INSERT);
+	journal_write(m_pending, (uint64_t)pos);
+	journal_write(m_pending, text, len);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::erase(size_t pos, size_t len) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, TEXT_ERASE);
+	journal_write(m_pending, (uint64_t)pos);
+	journal_write(m_pending, (uint64_t)len);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::clear() {
+	record(TEXT_CLEAR);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::assign() {
+	m_replaced = true;
+}
+
+// UNDO HISTORY RECORDS
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoAdd(int type, unsigned int pos, const std::u32string &insertText,
+                               const std::u32string &deleteText) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, UNDO_ADD);
+	journal_write(m_pending, (int32_t)type);
+	journal_write(m_pending, (uint32_t)pos);
+	journal_write(m_pending, insertText);
+	journal_write(m_pending, deleteText);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoAppendInsert(const std::u32string &text) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, UNDO_APPEND_INSERT);
+	journal_write(m_pending, text);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoAppendDelete(const std::u32string &text) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, UNDO_APPEND_DELETE);
+	journal_write(m_pending, text);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoPrependDelete(const std::u32string &text, unsigned int pos) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, UNDO_PREPEND_DELETE);
+	journal_write(m_pending, text);
+	journal_write(m_pending, (uint32_t)pos);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoTrim(size_t maxBytes, size_t maxActions) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, UNDO_TRIM);
+	journal_write(m_pending, (uint64_t)maxBytes);
+	journal_write(m_pending, (uint64_t)maxActions);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoClear() {
+	record(UNDO_CLEAR);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoUndo() {
+	record(UNDO_UNDO);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoRedo() {
+	record(UNDO_REDO);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::undoSwitchBranch(bool older) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, UNDO_SWITCH_BRANCH);
+	journal_write(m_pending, (uint8_t)older);
+	m_bytes += record_end(m_pending, start);
+}
+
+// PROTECTED
+
+//--------------------------------------------------------------
+void ofxEditorJournal::record(RecordType type) {
+	if(m_replaced) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t start = record_begin(m_pending, type);
+	m_bytes += record_end(m_pending, start);
+}
+
+//--------------------------------------------------------------
+void ofxEditorJournal::run() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(true) {
+
+		// batch records between syncs, checkpoints & closing don't wait
+		m_condition.wait_for(lock, std::chrono::milliseconds(JOURNAL_SYNC_MS), [this] {
+			return !m_running || m_checkpoint != NULL;
+		});
+		ofxEditorBuffer::Snapshot *checkpoint = m_checkpoint;
+		m_checkpoint = NULL;
+		std::string undo, pending;
+		undo.swap(m_checkpointUndo);
+		pending.swap(m_pending);
+		bool running = m_running;
+		lock.unlock();
+
+		// the journal is missing edits after a failed write, flag it so the
+		// main thread starts a new checkpoint with the next edit
+		if(checkpoint) {
+			std::string data;
+			journal_write(data, (uint32_t)JOURNAL_MAGIC);
+			journal_write(data, (uint32_t)JOURNAL_VERSION);
+			size_t start = record_begin(data, CHECKPOINT);
+			journal_write(data, (uint64_t)undo.size());
+			data += undo;
+			checkpoint->copy(data, 0);
+			record_end(data, start);
+			delete checkpoint; // release the shared text before writing
+			if(!writeCheckpoint(data)) {
+				m_failed = true;
+			}
+		}
+		if(!pending.empty() && !write(pending)) {
+			m_failed = true;
+		}
+
+		lock.lock();
+		if(!running) {
+			break;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+bool ofxEditorJournal::writeCheckpoint(const std::string &data) {
+
+	// write a new journal next to the current one & swap them, stop appending
+	// until the next checkpoint on error as the current journal is missing
+	// the edits before this checkpoint
+	if(m_file) {
+		fclose(m_file);
+		m_file = NULL;
+	}
+	std::string tmp = m_path + ".tmp";
+	FILE *file = fopen(tmp.c_str(), "wb");
+	if(!file) {
+		ofLogError("ofxEditorJournal") << "couldn't write journal \""
+			<< ofFilePath::getFileName(tmp) << "\"";
+		return false;
+	}
+	bool written = (fwrite(data.data(), 1, data.size(), file) == data.size() && file_sync(file));
+	fclose(file);
+	if(!written || !file_replace(tmp, m_path)) {
+		ofLogError("ofxEditorJournal") << "couldn't write journal \""
+			<< ofFilePath::getFileName(m_path) << "\"";
+		remove(tmp.c_str());
+		return false;
+	}
+	m_file = fopen(m_path.c_str(), "ab");
+	if(!m_file) {
+		ofLogError("ofxEditorJournal") << "couldn't open journal \""
+			<< ofFilePath::getFileName(m_path) << "\"";
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorJournal::write(const std::string &data) {
+	if(!m_file) {
+		return false;
+	}
+	if(fwrite(data.data(), 1, data.size(), m_file) != data.size() || !file_sync(m_file)) {
+		ofLogError("ofxEditorJournal") << "couldn't write journal \""
+			<< ofFilePath::getFileName(m_path) << "\"";
+		return false;
+	}
+	return true;
+}
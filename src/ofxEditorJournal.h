@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#pragma once
+
+#include "ofxEditorBuffer.h"
+
+#include <string>
+#include <cstdio>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class ofxEditorUndo;
+
+/// append-only crash recovery journal of text buffer & undo history edits
+///
+/// the buffer & undo history record each edit as it happens, records are
+/// batched in memory & written by a background thread which syncs the file
+/// to disk every JOURNAL_SYNC_MS so editing never waits on the disk
+///
+/// the journal starts with a checkpoint holding the full text & undo history
+/// followed by the edits since, once the edits outgrow the checkpoint a new
+/// journal is written to a temp file & renamed over the old one so the
+/// journal stays bounded & a crash always leaves a complete journal behind
+///
+/// records are checksummed & replay stops at the first partial or corrupt
+/// record, ie. one interrupted by a crash
+class ofxEditorJournal {
+
+	public:
+
+		ofxEditorJournal();
+		virtual ~ofxEditorJournal(); //< flushes & closes
+
+		/// record types
+		enum RecordType {
+			CHECKPOINT = 1, //< full text & undo history
+			TEXT_INSERT,
+			TEXT_ERASE,
+			TEXT_CLEAR,
+			UNDO_ADD,
+			UNDO_APPEND_INSERT,
+			UNDO_APPEND_DELETE,
+			UNDO_PREPEND_DELETE,
+			UNDO_TRIM,
+			UNDO_CLEAR,
+			UNDO_UNDO,
+			UNDO_REDO,
+			UNDO_SWITCH_BRANCH
+		};
+
+	/// \section Journal
+
+		/// open a journal file & start the writer thread, nothing is written
+		/// until the first checkpoint
+		void open(const std::string &path);
+
+		/// write any pending records, stop the writer thread, & close
+		void close();
+
+		/// is the journal open?
+		bool isOpen() const;
+
+		/// get the journal file path
+		const std::string& getPath() const;
+
+		/// replay a journal into a buffer & undo history, replay stops at the
+		/// first partial or corrupt record, returns false if the file can't
+		/// be read or isn't a journal
+		static bool replay(const std::string &path, ofxEditorBuffer &text, ofxEditorUndo &undo);
+
+		/// does the journal need a new checkpoint? ie. the text was replaced,
+		/// the edits since the last checkpoint are larger than it & the max
+		/// journal size, or the last checkpoint or edits couldn't be written
+		bool needsCheckpoint() const;
+
+		/// start a new journal from the current text & undo history, the
+		/// text is snapshotted & written by the writer thread
+		void checkpoint(const ofxEditorBuffer &text, const ofxEditorUndo &undo);
+
+		/// set the size in bytes the edits since the last checkpoint can
+		/// grow to before a new checkpoint is needed (default: 4 MB)
+		void setMaxBytes(size_t bytes);
+
+		/// get the max journal size in bytes
+		size_t getMaxBytes() const;
+
+	/// \section Text Buffer Records
+
+		/// called by ofxEditorBuffer for each edit
+
+		void insert(size_t pos, const char32_t *text, size_t len);
+		void erase(size_t pos, size_t len);
+		void clear();
+
+		/// the whole text was replaced, edits aren't recorded until the next
+		/// checkpoint as the replaced text is only written with the checkpoint
+		void assign();
+
+	/// \section Undo History Records
+
+		/// called by ofxEditorUndo for each change, see the matching
+		/// ofxEditorUndo functions
+
+		void undoAdd(int type, unsigned int pos, const std::u32string &insertText,
+		             const std::u32string &deleteText);
+		void undoAppendInsert(const std::u32string &text);
+		void undoAppendDelete(const std::u32string &text);
+		void undoPrependDelete(const std::u32string &text, unsigned int pos);
+		void undoTrim(size_t maxBytes, size_t maxActions);
+		void undoClear();
+		void undoUndo();
+		void undoRedo();
+		void undoSwitchBranch(bool older);
+
+	protected:
+
+		std::string m_path; //< journal file path
+		FILE *m_file;       //< open journal file, only used by the writer thread
+		size_t m_maxBytes;  //< max size of the edits since the last checkpoint
+
+		// main thread
+		size_t m_bytes;           //< bytes recorded since the last checkpoint
+		size_t m_checkpointBytes; //< approximate size of the last checkpoint
+		bool m_replaced;          //< text replaced since the last checkpoint?
+
+		// shared with the writer thread
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::thread m_thread;
+		std::string m_pending;         //< records waiting to be written
+		ofxEditorBuffer::Snapshot *m_checkpoint; //< pending checkpoint text or NULL
+		std::string m_checkpointUndo; //< pending checkpoint undo history
+		bool m_running;               //< is the writer thread running?
+		std::atomic<bool> m_failed;   //< couldn't write the last checkpoint or edits?
+
+		/// append a record without a payload
+		void record(RecordType type);
+
+		/// writer thread loop
+		void run();
+
+		/// write a checkpoint to a temp file & replace the journal with it,
+		/// data is the journal header & checkpoint record, returns false
+		/// on error
+		bool writeCheckpoint(const std::string &data);
+
+		/// write & sync data to the journal, returns false on error
+		bool write(const std::string &data);
+};
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+/// bounded lock-free multiple producer, single consumer queue
+///
+/// a ring of slots each with a sequence number which tells producers & the
+/// consumer whose turn it is, producers claim a slot by bumping the write
+/// pos with a compare & swap so pushes never block each other or the
+/// consumer, only moving the value in & out touches the slot itself
+///
+/// push fails when the queue is full, it's up to the caller to retry, wait,
+/// or drop the value
+///
+/// based on Dmitry Vyukov's bounded MPMC queue
+template<typename T>
+class ofxEditorQueue {
+
+	public:
+
+		/// create a queue with room for at least capacity values,
+		/// rounded up to the next power of 2
+		ofxEditorQueue(size_t capacity) : m_writePos(0), m_readPos(0) {
+			size_t size = 2;
+			while(size < capacity) {
+				size *= 2;
+			}
+			m_slots = std::vector<Slot>(size);
+			for(size_t i = 0; i < size; ++i) {
+				m_slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			m_mask = size-1;
+		}
+
+		/// push a value from any thread, the value is moved into the queue,
+		/// returns false & leaves the value as is if the queue is full
+		bool push(T &value) {
+			size_t pos = m_writePos.load(std::memory_order_relaxed);
+			Slot *slot;
+			while(true) {
+				slot = &m_slots[pos & m_mask];
+				size_t sequence = slot->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = (std::ptrdiff_t)(sequence - pos);
+				if(diff == 0) {
+					// slot is free, claim it
+					if(m_writePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+						break;
+					}
+				}
+				else if(diff < 0) {
+					return false; // full, slot still holds an unread value
+				}
+				else {
+					pos = m_writePos.load(std::memory_order_relaxed); // lost a race
+				}
+			}
+			slot->value = std::move(value);
+			slot->sequence.store(pos+1, std::memory_order_release);
+			return true;
+		}
+
+		/// pop the oldest value, only call from the consumer thread,
+		/// returns false if the queue is empty
+		bool pop(T &value) {
+			size_t pos = m_readPos.load(std::memory_order_relaxed);
+			Slot &slot = m_slots[pos & m_mask];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if((std::ptrdiff_t)(sequence - (pos+1)) < 0) {
+				return false; // empty or the value is still being pushed
+			}
+			value = std::move(slot.value);
+			slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+			m_readPos.store(pos+1, std::memory_order_relaxed);
+			return true;
+		}
+
+		/// max number of values in the queue
+		size_t capacity() const {
+			return m_mask+1;
+		}
+
+	protected:
+
+		/// queue slot, sequence == pos when free to push to & pos + 1 when
+		/// holding a value to pop
+		struct Slot {
+			std::atomic<size_t> sequence;
+			T value;
+			Slot() : sequence(0) {}
+		};
+
+		std::vector<Slot> m_slots; //< ring of slots
+		size_t m_mask;             //< ring size - 1 for wrapping positions
+
+		// keep the producer & consumer positions on separate cache lines
+		alignas(64) std::atomic<size_t> m_writePos; //< next pos to push to
+		alignas(64) std::atomic<size_t> m_readPos;  //< next pos to pop from
+};
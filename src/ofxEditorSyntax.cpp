@@ -21,14 +21,93 @@
 #include "Unicode.h"
 #include "ofLog.h"
 #include "ofXml.h"
+#include "ofFileUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+// binary cache, values are written in native byte order so the magic
+// number doesn't match on a machine with another byte order
+#define CACHE_EXT     ".bin"
+#define CACHE_MAGIC   0x5358464F // "OFXS" on little endian
+#define CACHE_VERSION 1
+
+/// append a uint32 to a cache buffer
+static inline void cache_write(std::string &out, uint32_t value) {
+	out.append((const char *)&value, sizeof(value));
+}
+
+/// append a length prefixed string to a cache buffer
+static inline void cache_write(std::string &out, const std::string &value) {
+	cache_write(out, (uint32_t)value.size());
+	out.append(value);
+}
+
+/// append a length prefixed wide string to a cache buffer
+static inline void cache_write(std::string &out, const std::u32string &value) {
+	cache_write(out, (uint32_t)value.size());
+	out.append((const char *)value.data(), value.size()*sizeof(char32_t));
+}
+
+/// read size bytes from a cache buffer at pos, advances pos, returns false
+/// if the buffer is too short
+static inline bool cache_read(const ofBuffer &in, size_t &pos, void *dest, size_t size) {
+	if(size > in.size() - pos) {
+		return false;
+	}
+	memcpy(dest, in.getData() + pos, size);
+	pos += size;
+	return true;
+}
+
+/// read a uint32 from a cache buffer
+static inline bool cache_read(const ofBuffer &in, size_t &pos, uint32_t &value) {
+	return cache_read(in, pos, &value, sizeof(value));
+}
+
+/// read a length prefixed string from a cache buffer
+static inline bool cache_read(const ofBuffer &in, size_t &pos, std::string &value) {
+	uint32_t length;
+	if(!cache_read(in, pos, length) || length > in.size() - pos) {
+		return false;
+	}
+	value.assign(in.getData() + pos, length);
+	pos += length;
+	return true;
+}
+
+/// read a length prefixed wide string from a cache buffer
+static inline bool cache_read(const ofBuffer &in, size_t &pos, std::u32string &value) {
+	uint32_t length;
+	if(!cache_read(in, pos, length) || length > (in.size() - pos) / sizeof(char32_t)) {
+		return false;
+	}
+	value.resize(length);
+	return cache_read(in, pos, &value[0], length*sizeof(char32_t));
+}
+
+/// is the cache file at least as new as the xml file?
+static inline bool cache_is_current(const std::string &xmlPath, const std::string &cachePath) {
+	std::error_code error;
+	of::filesystem::file_time_type xmlTime = of::filesystem::last_write_time(xmlPath, error);
+	if(error) {
+		return false;
+	}
+	of::filesystem::file_time_type cacheTime = of::filesystem::last_write_time(cachePath, error);
+	return !error && cacheTime >= xmlTime;
+}
 
 //--------------------------------------------------------------
 ofxEditorSyntax::ofxEditorSyntax() {
+	compiledRevision = 0;
+	wordsCompiled = false;
 	clear();
 }
 
 //--------------------------------------------------------------
 ofxEditorSyntax::ofxEditorSyntax(const std::string& xmlFile) {
+	compiledRevision = 0;
+	wordsCompiled = false;
 	if(!loadFile(xmlFile)) {
 		clear();
 	}
@@ -36,6 +115,8 @@ ofxEditorSyntax::ofxEditorSyntax(const std::string& xmlFile) {
 
 //--------------------------------------------------------------
 ofxEditorSyntax::ofxEditorSyntax(const ofxEditorSyntax &from) {
+	compiledRevision = 0;
+	wordsCompiled = false;
 	copy(from);
 }
 
@@ -52,6 +133,8 @@ void ofxEditorSyntax::copy(const ofxEditorSyntax &from) {
 	singleLineComment = from.singleLineComment;
 	multiLineCommentBegin = from.multiLineCommentBegin;
 	multiLineCommentEnd = from.multiLineCommentEnd;
+	stringLiteralBegin = from.stringLiteralBegin;
+	stringLiteralEnd = from.stringLiteralEnd;
 	preprocessor = from.preprocessor;
 	hexLiteral = from.hexLiteral;
 	operatorChars = from.operatorChars;
@@ -66,11 +149,28 @@ void ofxEditorSyntax::copy(const ofxEditorSyntax &from) {
 	for(std::set<std::string>::const_iterator iter = from.fileExts.begin(); iter != from.fileExts.end(); ++iter) {
 		fileExts.insert((*iter));
 	}
+	
+	// the compiled tables may hold the only copy of the words
+	wordsCompiled = from.wordsCompiled;
+	std::copy(from.charClasses, from.charClasses+256, charClasses);
+	wideCharClasses = from.wideCharClasses;
+	wordTable = from.wordTable;
+	wordChars = from.wordChars;
+	wordMinLength = from.wordMinLength;
+	wordMaxLength = from.wordMaxLength;
+	changed();
+	if(from.compiledRevision == from.revision) {
+		compiledRevision = revision;
+	}
 }
 
 //--------------------------------------------------------------
 bool ofxEditorSyntax::loadFile(const std::string& xmlFile) {
 	std::string path = ofToDataPath(xmlFile);
+	std::string cachePath = path + CACHE_EXT;
+	if(cache_is_current(path, cachePath) && loadCache(cachePath)) {
+		return true;
+	}
 	ofXml xml;
 	if(!xml.load(path)) {
 		ofLogError("ofxEditorSyntax") << "couldn't load \""
@@ -98,7 +198,7 @@ bool ofxEditorSyntax::loadFile(const std::string& xmlFile) {
 			auto begin = child.getChild("begin");
 			auto end = child.getChild("end");
 			if(begin) {multiLineCommentBegin = string_to_wstring(begin.getValue());}
-			if(end) {multiLineCommentBegin = string_to_wstring(end.getValue());}
+			if(end) {multiLineCommentEnd = string_to_wstring(end.getValue());}
 		}
 		else if(child.getName() == "stringliteral")  {
 			auto begin = child.getChild("begin");
@@ -131,6 +231,8 @@ bool ofxEditorSyntax::loadFile(const std::string& xmlFile) {
 			ofLogWarning("ofxEditorSyntax") << "ignoring unknown xml tag \"" << child.getName() << "\"";
 		}
 	}
+	changed();
+	saveCache(cachePath);
 	
 	return true;
 }
@@ -149,6 +251,7 @@ void ofxEditorSyntax::clear() {
 	operatorChars = U"=+-*/!|&~^";
 	punctuationChars = U";:,?";
 	clearAllWords();
+	changed();
 }
 
 // META
@@ -212,11 +315,13 @@ void ofxEditorSyntax::clearAllFileExts() {
 //--------------------------------------------------------------
 void ofxEditorSyntax::setSingleLineComment(const std::u32string &begin) {
 	singleLineComment = begin;
+	changed();
 }
 
 //--------------------------------------------------------------
 void ofxEditorSyntax::setSingleLineComment(const std::string &begin) {
 	singleLineComment = string_to_wstring(begin);
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -233,12 +338,14 @@ std::string ofxEditorSyntax::getSingleLineComment() {
 void ofxEditorSyntax::setMultiLineComment(const std::u32string &begin, const std::u32string &end) {
 	multiLineCommentBegin = begin;
 	multiLineCommentEnd = end;
+	changed();
 }
 
 //--------------------------------------------------------------
 void ofxEditorSyntax::setMultiLineComment(const std::string &begin, const std::string &end) {
 	multiLineCommentBegin = string_to_wstring(begin);
 	multiLineCommentEnd = string_to_wstring(end);
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -268,12 +375,14 @@ std::string ofxEditorSyntax::getMultiLineCommentEnd() {
 void ofxEditorSyntax::setStringLiteral(const std::u32string &begin, const std::u32string &end) {
 	stringLiteralBegin = begin;
 	stringLiteralEnd = end;
+	changed();
 }
 
 //--------------------------------------------------------------
 void ofxEditorSyntax::setStringLiteral(const std::string &begin, const std::string &end) {
 	stringLiteralBegin = string_to_wstring(begin);
 	stringLiteralEnd = string_to_wstring(end);
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -304,11 +413,13 @@ std::string ofxEditorSyntax::getStringLiteralEnd() {
 //--------------------------------------------------------------
 void ofxEditorSyntax::setPreprocessor(const std::u32string &begin) {
 	preprocessor = begin;
+	changed();
 }
 
 //--------------------------------------------------------------
 void ofxEditorSyntax::setPreprocessor(const std::string &begin) {
 	preprocessor = string_to_wstring(begin);
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -326,7 +437,9 @@ std::string ofxEditorSyntax::getPreprocessor() {
 //--------------------------------------------------------------
 void ofxEditorSyntax::setWord(const std::u32string &word, WordType type) {
 	if(word == U"") return;
+	expandWords();
 	words[word] = type;
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -350,11 +463,7 @@ void ofxEditorSyntax::setWords(const std::vector<std::string> &words, WordType t
 
 //--------------------------------------------------------------
 ofxEditorSyntax::WordType ofxEditorSyntax::getWordType(const std::u32string &word) {
-	std::map<std::u32string,WordType>::iterator iter = words.find(word);
-	if(iter != words.end()) { // already exists
-		return (*iter).second;
-	}
-	return PLAIN;
+	return getWordType(word.data(), word.size());
 }
 
 //--------------------------------------------------------------
@@ -362,35 +471,95 @@ ofxEditorSyntax::WordType ofxEditorSyntax::getWordType(const std::string &word)
 	return getWordType(string_to_wstring(word));
 }
 
+//--------------------------------------------------------------
+ofxEditorSyntax::WordType ofxEditorSyntax::getWordType(const char32_t *word, size_t length) {
+	if(compiledRevision != revision) {
+		compile();
+	}
+	if(length < wordMinLength || length > wordMaxLength) {
+		return PLAIN;
+	}
+	size_t mask = wordTable.size()-1;
+	unsigned int hash = hashWord(word, length);
+	for(size_t i = hash & mask;; i = (i+1) & mask) { // linear probing
+		const WordEntry &entry = wordTable[i];
+		if(entry.length == 0) { // empty slot ends the probe
+			return PLAIN;
+		}
+		if(entry.hash == hash && entry.length == length &&
+		   std::char_traits<char32_t>::compare(&wordChars[entry.offset], word, length) == 0) {
+			return entry.type;
+		}
+	}
+}
+
 //--------------------------------------------------------------
 void ofxEditorSyntax::clearWord(const std::u32string &word) {
+	expandWords();
 	std::map<std::u32string,WordType>::iterator iter = words.find(word);
 	if(iter != words.end()) { // already exists
 		words.erase(iter);
+		changed();
 	}
 }
 
 //--------------------------------------------------------------
 void ofxEditorSyntax::clearWord(const std::string &word) {
-	clearWord(word);
+	clearWord(string_to_wstring(word));
 }
 
 //--------------------------------------------------------------
 void ofxEditorSyntax::clearWordType(WordType type) {
+	expandWords();
 	std::map<std::u32string,WordType>::iterator iter = words.begin();
 	while(iter != words.end()) {
 		if((*iter).second == type) {
-			words.erase(++iter);
+			iter = words.erase(iter);
 		}
 		else {
 			++iter;
 		}
 	}
+	changed();
 }
 
 //--------------------------------------------------------------
 void ofxEditorSyntax::clearAllWords() {
 	words.clear();
+	wordsCompiled = false;
+	changed();
+}
+
+// CHAR CLASSES
+
+//--------------------------------------------------------------
+unsigned int ofxEditorSyntax::getCharClass(char32_t c) {
+	if(compiledRevision != revision) {
+		compile();
+	}
+	if(c < 256) {
+		return charClasses[c];
+	}
+	if(wideCharClasses.empty()) {
+		return CLASS_NONE;
+	}
+	std::map<char32_t,unsigned char>::const_iterator iter = wideCharClasses.find(c);
+	return (iter != wideCharClasses.end() ? (*iter).second : CLASS_NONE);
+}
+
+//--------------------------------------------------------------
+const unsigned char* ofxEditorSyntax::getCharClasses() {
+	if(compiledRevision != revision) {
+		compile();
+	}
+	return charClasses;
+}
+
+// CHANGES
+
+//--------------------------------------------------------------
+unsigned int ofxEditorSyntax::getRevision() {
+	return revision;
 }
 
 // PARSING CHARS
@@ -398,6 +567,7 @@ void ofxEditorSyntax::clearAllWords() {
 //--------------------------------------------------------------
 void ofxEditorSyntax::setHexLiteral(bool hex) {
 	hexLiteral = hex;
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -412,6 +582,7 @@ void ofxEditorSyntax::setOperatorChars(const std::u32string &chars) {
 		return;
 	}
 	operatorChars = chars;
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -436,6 +607,7 @@ void ofxEditorSyntax::setPunctuationChars(const std::u32string &chars) {
 		return;
 	}
 	punctuationChars = chars;
+	changed();
 }
 
 //--------------------------------------------------------------
@@ -452,3 +624,245 @@ const std::u32string& ofxEditorSyntax::getWidePunctuationChars() {
 std::string ofxEditorSyntax::getPunctuationChars() {
 	return wstring_to_string(punctuationChars);
 }
+
+// PRIVATE
+
+//--------------------------------------------------------------
+void ofxEditorSyntax::changed() {
+	static unsigned int s_revision = 0;
+	revision = ++s_revision;
+}
+
+//--------------------------------------------------------------
+unsigned int ofxEditorSyntax::hashWord(const char32_t *word, size_t length) {
+	unsigned int hash = 2166136261u; // FNV-1a
+	for(size_t i = 0; i < length; ++i) {
+		hash = (hash ^ word[i]) * 16777619u;
+	}
+	return hash;
+}
+
+//--------------------------------------------------------------
+void ofxEditorSyntax::compile() {
+	expandWords();
+	
+	// char classes
+	std::fill(charClasses, charClasses+256, CLASS_NONE);
+	wideCharClasses.clear();
+	for(size_t i = 0; i < operatorChars.size(); ++i) {
+		addCharClass(operatorChars[i], CLASS_OPERATOR);
+	}
+	for(size_t i = 0; i < punctuationChars.size(); ++i) {
+		addCharClass(punctuationChars[i], CLASS_PUNCTUATION);
+	}
+	if(!stringLiteralBegin.empty()) {
+		addCharClass(stringLiteralBegin.front(), CLASS_LITERAL_BEGIN);
+	}
+	if(!stringLiteralEnd.empty()) {
+		addCharClass(stringLiteralEnd.back(), CLASS_LITERAL_END);
+	}
+	if(!multiLineCommentBegin.empty()) {
+		addCharClass(multiLineCommentBegin.front(), CLASS_COMMENT_BEGIN);
+	}
+	if(!multiLineCommentEnd.empty()) {
+		addCharClass(multiLineCommentEnd.back(), CLASS_COMMENT_END);
+	}
+	if(!singleLineComment.empty()) {
+		addCharClass(singleLineComment.front(), CLASS_SINGLE_COMMENT);
+	}
+	if(!preprocessor.empty()) {
+		addCharClass(preprocessor.front(), CLASS_PREPROCESSOR);
+	}
+	
+	// words
+	
+	// power of 2 size at most half full keeps probe runs short
+	size_t size = 8;
+	while(size < words.size()*2) {
+		size *= 2;
+	}
+	wordTable.assign(size, WordEntry());
+	wordChars.clear();
+	wordMinLength = (words.empty() ? 1 : (size_t)-1);
+	wordMaxLength = 0;
+	
+	for(std::map<std::u32string,WordType>::const_iterator iter = words.begin(); iter != words.end(); ++iter) {
+		const std::u32string &word = (*iter).first;
+		WordEntry entry;
+		entry.hash = hashWord(word.data(), word.size());
+		entry.offset = wordChars.size();
+		entry.length = word.size();
+		entry.type = (*iter).second;
+		wordChars += word;
+		size_t i = entry.hash & (size-1);
+		while(wordTable[i].length != 0) {
+			i = (i+1) & (size-1);
+		}
+		wordTable[i] = entry;
+		wordMinLength = std::min(wordMinLength, word.size());
+		wordMaxLength = std::max(wordMaxLength, word.size());
+	}
+	compiledRevision = revision;
+}
+
+//--------------------------------------------------------------
+void ofxEditorSyntax::addCharClass(char32_t c, unsigned char flags) {
+	if(c < 256) {
+		charClasses[c] |= flags;
+	}
+	else {
+		wideCharClasses[c] |= flags;
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditorSyntax::expandWords() {
+	if(!wordsCompiled) {
+		return;
+	}
+	for(size_t i = 0; i < wordTable.size(); ++i) {
+		const WordEntry &entry = wordTable[i];
+		if(entry.length != 0) {
+			words[wordChars.substr(entry.offset, entry.length)] = entry.type;
+		}
+	}
+	wordsCompiled = false;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorSyntax::loadCache(const std::string &path) {
+	ofFile file;
+	if(!file.open(path, ofFile::ReadOnly, true)) {
+		return false;
+	}
+	ofBuffer buffer = file.readToBuffer();
+	file.close();
+	
+	// header
+	size_t pos = 0;
+	uint32_t magic, version, entrySize;
+	if(!cache_read(buffer, pos, magic) || magic != CACHE_MAGIC ||
+	   !cache_read(buffer, pos, version) || version != CACHE_VERSION ||
+	   !cache_read(buffer, pos, entrySize) || entrySize != sizeof(WordEntry)) {
+		ofLogVerbose("ofxEditorSyntax") << "ignoring stale cache \""
+			<< ofFilePath::getFileName(path) << "\"";
+		return false;
+	}
+	
+	// syntax
+	clear();
+	uint32_t count, hex, minLength, maxLength;
+	bool ok = cache_read(buffer, pos, lang) && cache_read(buffer, pos, count);
+	for(uint32_t i = 0; ok && i < count; ++i) {
+		std::string ext;
+		ok = cache_read(buffer, pos, ext);
+		fileExts.insert(ext);
+	}
+	ok = ok &&
+		cache_read(buffer, pos, singleLineComment) &&
+		cache_read(buffer, pos, multiLineCommentBegin) &&
+		cache_read(buffer, pos, multiLineCommentEnd) &&
+		cache_read(buffer, pos, stringLiteralBegin) &&
+		cache_read(buffer, pos, stringLiteralEnd) &&
+		cache_read(buffer, pos, preprocessor) &&
+		cache_read(buffer, pos, operatorChars) &&
+		cache_read(buffer, pos, punctuationChars) &&
+		cache_read(buffer, pos, hex);
+	hexLiteral = (hex != 0);
+	
+	// compiled tables, the word table is used as is so the words are only
+	// put in the word map if they change
+	ok = ok && cache_read(buffer, pos, charClasses, sizeof(charClasses)) &&
+		cache_read(buffer, pos, count);
+	for(uint32_t i = 0; ok && i < count; ++i) {
+		uint32_t c, flags;
+		ok = cache_read(buffer, pos, c) && cache_read(buffer, pos, flags);
+		wideCharClasses[c] = flags;
+	}
+	ok = ok && cache_read(buffer, pos, minLength) && cache_read(buffer, pos, maxLength) &&
+		cache_read(buffer, pos, count) && count > 0 && (count & (count-1)) == 0 &&
+		count <= (buffer.size() - pos) / sizeof(WordEntry);
+	if(ok) {
+		wordTable.resize(count);
+		ok = cache_read(buffer, pos, &wordTable[0], count*sizeof(WordEntry)) &&
+			cache_read(buffer, pos, wordChars);
+	}
+	size_t used = 0;
+	for(size_t i = 0; ok && i < wordTable.size(); ++i) {
+		const WordEntry &entry = wordTable[i];
+		ok = (entry.offset <= wordChars.size() && entry.length <= wordChars.size() - entry.offset &&
+		      entry.type >= PLAIN && entry.type <= FUNCTION);
+		used += (entry.length != 0);
+	}
+
+	// lookups stop at an empty slot, so keep the table at most half full
+	// as compile() does
+	ok = ok && used <= wordTable.size()/2;
+	if(!ok) {
+		ofLogWarning("ofxEditorSyntax") << "couldn't read cache \""
+			<< ofFilePath::getFileName(path) << "\"";
+		clear();
+		return false;
+	}
+	wordMinLength = minLength;
+	wordMaxLength = maxLength;
+	wordsCompiled = true;
+	changed();
+	compiledRevision = revision;
+	
+	return true;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorSyntax::saveCache(const std::string &path) {
+	if(compiledRevision != revision) {
+		compile();
+	}
+	
+	// header
+	std::string out;
+	cache_write(out, CACHE_MAGIC);
+	cache_write(out, CACHE_VERSION);
+	cache_write(out, sizeof(WordEntry));
+	
+	// syntax
+	cache_write(out, lang);
+	cache_write(out, fileExts.size());
+	for(std::set<std::string>::const_iterator iter = fileExts.begin(); iter != fileExts.end(); ++iter) {
+		cache_write(out, (*iter));
+	}
+	cache_write(out, singleLineComment);
+	cache_write(out, multiLineCommentBegin);
+	cache_write(out, multiLineCommentEnd);
+	cache_write(out, stringLiteralBegin);
+	cache_write(out, stringLiteralEnd);
+	cache_write(out, preprocessor);
+	cache_write(out, operatorChars);
+	cache_write(out, punctuationChars);
+	cache_write(out, hexLiteral ? 1 : 0);
+	
+	// compiled tables
+	out.append((const char *)charClasses, sizeof(charClasses));
+	cache_write(out, wideCharClasses.size());
+	for(std::map<char32_t,unsigned char>::const_iterator iter = wideCharClasses.begin(); iter != wideCharClasses.end(); ++iter) {
+		cache_write(out, (*iter).first);
+		cache_write(out, (*iter).second);
+	}
+	cache_write(out, wordMinLength);
+	cache_write(out, wordMaxLength);
+	cache_write(out, wordTable.size());
+	out.append((const char *)wordTable.data(), wordTable.size()*sizeof(WordEntry));
+	cache_write(out, wordChars);
+	
+	ofFile file;
+	if(!file.open(path, ofFile::WriteOnly, true)) {
+		ofLogVerbose("ofxEditorSyntax") << "couldn't save cache \""
+			<< ofFilePath::getFileName(path) << "\"";
+		return false;
+	}
+	ofBuffer buffer;
+	buffer.set(out.data(), out.size());
+	bool saved = file.writeFromBuffer(buffer);
+	file.close();
+	return saved;
+}
@@ -22,6 +22,7 @@
 #include "ofConstants.h"
 #include <set>
 #include <map>
+#include <vector>
 
 /// language-specific syntax words and characters
 class ofxEditorSyntax {
@@ -90,6 +91,10 @@ class ofxEditorSyntax {
 		///
 		/// </syntax>
 		///
+		/// the parsed syntax & its compiled word & char class tables are saved
+		/// to a binary cache next to the xml file, ie. "glsl.xml.bin", which is
+		/// loaded instead as long as it is newer than the xml file
+		///
 		/// returns false on read or parse error
 		bool loadFile(const std::string& xmlFile);
 	
@@ -183,6 +188,10 @@ class ofxEditorSyntax {
 		WordType getWordType(const std::u32string &word);
 		WordType getWordType(const std::string &word);
 	
+		/// get type for a word of length chars without copying it, the words
+		/// are compiled into a flat hash table on the first lookup after a change
+		WordType getWordType(const char32_t *word, size_t length);
+	
 		/// clear type for word
 		void clearWord(const std::u32string &word);
 		void clearWord(const std::string &word);
@@ -193,6 +202,37 @@ class ofxEditorSyntax {
 		/// clear all words (keyword, typename, function)
 		void clearAllWords();
 	
+	/// \section Char Classes
+	
+		/// char class flags used by the syntax parser to skip checks which
+		/// can't match, delimiter classes are set for the char which starts
+		/// or ends a delimiter
+		enum CharClass {
+			CLASS_NONE           = 0,
+			CLASS_OPERATOR       = 1 << 0, //< operator char
+			CLASS_PUNCTUATION    = 1 << 1, //< punctuation char
+			CLASS_LITERAL_BEGIN  = 1 << 2, //< first char of string literal begin
+			CLASS_LITERAL_END    = 1 << 3, //< last char of string literal end
+			CLASS_COMMENT_BEGIN  = 1 << 4, //< first char of multi line comment begin
+			CLASS_COMMENT_END    = 1 << 5, //< last char of multi line comment end
+			CLASS_SINGLE_COMMENT = 1 << 6, //< first char of single line comment
+			CLASS_PREPROCESSOR   = 1 << 7  //< first char of preprocessor begin
+		};
+	
+		/// get the CharClass flags for a char, the flags are compiled into a
+		/// table along with the words on the first lookup after a change
+		unsigned int getCharClass(char32_t c);
+	
+		/// get the compiled CharClass flags table for chars below 256
+		const unsigned char* getCharClasses();
+	
+	/// \section Changes
+	
+		/// get the revision which changes whenever the comment, string, or
+		/// preprocessor delimiters, words, or parsing chars change, revisions
+		/// are unique across syntax objects
+		unsigned int getRevision();
+	
 	/// \section Parsing Chars
 	
 		/// parse "0x123" as a number?
@@ -231,4 +271,49 @@ class ofxEditorSyntax {
 		bool hexLiteral; //< parse hex literals (0x123) as numbers?
 		std::u32string operatorChars; //< common operator chars
 		std::u32string punctuationChars; //< punctuation chars
+	
+		unsigned int revision; //< current revision, see getRevision()
+	
+	private:
+	
+		/// compiled word, chars are stored in wordChars
+		struct WordEntry {
+			unsigned int hash;   //< word hash
+			unsigned int offset; //< word start in wordChars
+			unsigned int length; //< word length, 0 for an empty slot
+			WordType type;       //< word type
+			WordEntry() : hash(0), offset(0), length(0), type(PLAIN) {}
+		};
+		unsigned char charClasses[256]; //< compiled CharClass flags for chars < 256
+		std::map<char32_t,unsigned char> wideCharClasses; //< flags for chars >= 256
+		std::vector<WordEntry> wordTable; //< open addressed, power of 2 size
+		std::u32string wordChars;  //< compiled words back to back
+		size_t wordMinLength;      //< shortest compiled word
+		size_t wordMaxLength;      //< longest compiled word
+		unsigned int compiledRevision; //< revision when compiled
+		bool wordsCompiled; //< words are only in the compiled table, see expandWords()
+	
+		/// bump the revision after a change
+		void changed();
+	
+		/// fill the word map from the compiled table after loading a cache,
+		/// the map is only needed when the words change or are recompiled
+		void expandWords();
+	
+		/// load the syntax & compiled tables from a binary cache file,
+		/// returns false if the file is missing, from another version, or
+		/// can't be read
+		bool loadCache(const std::string &path);
+	
+		/// save the syntax & compiled tables to a binary cache file
+		bool saveCache(const std::string &path);
+	
+		/// hash a word of length chars
+		static unsigned int hashWord(const char32_t *word, size_t length);
+	
+		/// build the word hash table & char class tables
+		void compile();
+	
+		/// add CharClass flags for a char
+		void addCharClass(char32_t c, unsigned char flags);
 };
@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#include "ofxEditorUndo.h"
+#include "ofxEditorJournal.h"
+#include "Unicode.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+// don't bother reclaiming arena space below this many bytes
+#define MIN_COMPACT_BYTES 4096
+
+/// saved history header, offsets are in the arena
+struct UndoSaveHeader {
+	uint64_t actionSize; //< sizeof(Action) when saved
+	uint64_t numActions;
+	uint64_t first, current, rootRedo, rootNewest;
+	uint64_t textFront, textEnd;
+};
+
+//--------------------------------------------------------------
+ofxEditorUndo::ofxEditorUndo() {
+	m_first = 0;
+	m_current = npos;
+	m_rootRedo = npos;
+	m_rootNewest = npos;
+	m_textBase = 0;
+	m_textFront = 0;
+	m_journal = NULL;
+}
+
+// EDIT
+
+//--------------------------------------------------------------
+void ofxEditorUndo::add(int type, unsigned int pos, const std::u32string &insertText,
+                        const std::u32string &deleteText, long timestamp) {
+	if(m_journal) {
+		m_journal->undoAdd(type, pos, insertText, deleteText);
+	}
+	size_t id = m_first + m_actions.size();
+	Action a;
+	a.type = type;
+	a.pos = pos;
+	a.timestamp = timestamp;
+	a.insertLength = insertText.size();
+	a.deleteLength = deleteText.size();
+	a.insertStart = store(insertText, a.insertBytes);
+	a.deleteStart = store(deleteText, a.deleteBytes);
+	a.redo = a.newest = a.newer = npos;
+
+	// newest child of the current action, redo follows it
+	Action *parent = find(m_current);
+	if(parent) {
+		a.parent = m_current;
+		a.older = parent->newest;
+		parent->newest = parent->redo = id;
+	}
+	else {
+		a.parent = m_current; // npos or evicted
+		a.older = (m_current == npos ? m_rootNewest : npos);
+		if(m_current == npos) {
+			m_rootNewest = m_rootRedo = id;
+		}
+	}
+	Action *older = find(a.older);
+	if(older) {
+		older->newer = id;
+	}
+	else {
+		a.older = npos;
+	}
+	m_actions.push_back(a);
+	m_current = id;
+}
+
+//--------------------------------------------------------------
+ofxEditorUndo::Action* ofxEditorUndo::getExtendable() {
+	if(m_actions.empty() || m_current != m_first + m_actions.size()-1) {
+		return NULL;
+	}
+	return &m_actions.back();
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::appendInsertText(const std::u32string &text) {
+	Action *a = getExtendable();
+	if(!a) {
+		return;
+	}
+	if(m_journal) {
+		m_journal->undoAppendInsert(text);
+	}
+	if(a->insertStart + a->insertBytes != textEnd()) {
+		a->insertStart = moveToEnd(a->insertStart, a->insertBytes);
+	}
+	size_t bytes;
+	store(text, bytes);
+	a->insertBytes += bytes;
+	a->insertLength += text.size();
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::appendDeleteText(const std::u32string &text) {
+	Action *a = getExtendable();
+	if(!a) {
+		return;
+	}
+	if(m_journal) {
+		m_journal->undoAppendDelete(text);
+	}
+	if(a->deleteStart + a->deleteBytes != textEnd()) {
+		a->deleteStart = moveToEnd(a->deleteStart, a->deleteBytes);
+	}
+	size_t bytes;
+	store(text, bytes);
+	a->deleteBytes += bytes;
+	a->deleteLength += text.size();
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::prependDeleteText(const std::u32string &text, unsigned int pos) {
+	Action *a = getExtendable();
+	if(!a) {
+		return;
+	}
+	if(m_journal) {
+		m_journal->undoPrependDelete(text, pos);
+	}
+	size_t bytes, start = store(text, bytes);
+	m_text.append(m_text, a->deleteStart - m_textBase, a->deleteBytes);
+	a->deleteStart = start;
+	a->deleteBytes += bytes;
+	a->deleteLength += text.size();
+	a->pos = pos;
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::trim(size_t maxBytes, size_t maxActions) {
+	bool evicted = false;
+	while(m_actions.size() > 1 &&
+	      (getNumBytes() > maxBytes || (maxActions > 0 && m_actions.size() > maxActions))) {
+		m_actions.pop_front();
+		m_first++;
+		const Action &a = m_actions.front();
+		m_textFront = std::min(a.insertStart, a.deleteStart);
+		evicted = true;
+	}
+	if(!evicted) {
+		return;
+	}
+	if(m_journal) {
+		m_journal->undoTrim(maxBytes, maxActions);
+	}
+
+	// reclaim the arena before the oldest action once it's over half
+	size_t unused = m_textFront - m_textBase;
+	if(unused >= MIN_COMPACT_BYTES && unused > m_text.size()/2) {
+		m_text.erase(0, unused);
+		m_textBase = m_textFront;
+	}
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::clear() {
+	if(m_journal) {
+		m_journal->undoClear();
+	}
+	m_actions.clear();
+	m_first = 0;
+	m_current = npos;
+	m_rootRedo = npos;
+	m_rootNewest = npos;
+	m_text.clear();
+	m_textBase = 0;
+	m_textFront = 0;
+}
+
+// UNDO & REDO
+
+//--------------------------------------------------------------
+const ofxEditorUndo::Action* ofxEditorUndo::undo() {
+	Action *a = find(m_current);
+	if(!a) {
+		return NULL;
+	}
+	Action *parent = find(a->parent);
+	if(parent) {
+		parent->redo = m_current;
+	}
+	else if(a->parent == npos) {
+		m_rootRedo = m_current;
+	}
+	else {
+		return NULL; // the text before the parent is gone
+	}
+	if(m_journal) {
+		m_journal->undoUndo();
+	}
+	m_current = a->parent;
+	return a;
+}
+
+//--------------------------------------------------------------
+const ofxEditorUndo::Action* ofxEditorUndo::redo() {
+	size_t next;
+	if(m_current == npos) {
+		next = m_rootRedo;
+	}
+	else {
+		Action *a = find(m_current);
+		if(!a) {
+			return NULL;
+		}
+		next = a->redo;
+	}
+	Action *a = find(next);
+	if(!a) {
+		return NULL;
+	}
+	if(m_journal) {
+		m_journal->undoRedo();
+	}
+	m_current = next;
+	return a;
+}
+
+//--------------------------------------------------------------
+bool ofxEditorUndo::switchBranch(bool older) {
+	size_t *redo = &m_rootRedo;
+	if(m_current != npos) {
+		Action *a = find(m_current);
+		if(!a) {
+			return false;
+		}
+		redo = &a->redo;
+	}
+	Action *a = find(*redo);
+	if(!a) {
+		return false;
+	}
+	size_t sibling = (older ? a->older : a->newer);
+	if(!find(sibling)) {
+		return false;
+	}
+	if(m_journal) {
+		m_journal->undoSwitchBranch(older);
+	}
+	*redo = sibling;
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::getInsertText(const Action &action, std::u32string &text) const {
+	text.clear();
+	string_append(text, m_text.data() + (action.insertStart - m_textBase), action.insertBytes);
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::getDeleteText(const Action &action, std::u32string &text) const {
+	text.clear();
+	string_append(text, m_text.data() + (action.deleteStart - m_textBase), action.deleteBytes);
+}
+
+// ACCESS
+
+//--------------------------------------------------------------
+const ofxEditorUndo::Action& ofxEditorUndo::get(size_t id) const {
+	return m_actions[id - m_first];
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorUndo::getFirst() const {
+	return m_first;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorUndo::getCurrent() const {
+	return m_current;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorUndo::size() const {
+	return m_actions.size();
+}
+
+//--------------------------------------------------------------
+bool ofxEditorUndo::empty() const {
+	return m_actions.empty();
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorUndo::getNumBytes() const {
+	return (textEnd() - m_textFront) + m_actions.size()*sizeof(Action);
+}
+
+// SAVE & LOAD
+
+//--------------------------------------------------------------
+void ofxEditorUndo::save(std::string &data) const {
+	UndoSaveHeader header;
+	header.actionSize = sizeof(Action);
+	header.numActions = m_actions.size();
+	header.first = m_first;
+	header.current = m_current;
+	header.rootRedo = m_rootRedo;
+	header.rootNewest = m_rootNewest;
+	header.textFront = m_textFront;
+	header.textEnd = textEnd();
+	data.append((const char *)&header, sizeof(header));
+	for(size_t i = 0; i < m_actions.size(); ++i) {
+		data.append((const char *)&m_actions[i], sizeof(Action));
+	}
+	data.append(m_text, m_textFront - m_textBase, std::string::npos);
+}
+
+//--------------------------------------------------------------
+bool ofxEditorUndo::load(const char *data, size_t size) {
+	ofxEditorJournal *journal = m_journal;
+	m_journal = NULL;
+	clear();
+	m_journal = journal;
+	UndoSaveHeader header;
+	if(size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	size_t actionBytes = header.numActions * sizeof(Action);
+	if(header.actionSize != sizeof(Action) || header.textEnd < header.textFront ||
+	   header.numActions > (size - sizeof(header)) / sizeof(Action) ||
+	   header.textEnd - header.textFront != size - sizeof(header) - actionBytes) {
+		return false;
+	}
+	data += sizeof(header);
+	m_actions.resize(header.numActions);
+	for(size_t i = 0; i < m_actions.size(); ++i) {
+		Action &a = m_actions[i];
+		memcpy(&a, data, sizeof(Action));
+		data += sizeof(Action);
+		if(a.insertStart < header.textFront || a.insertStart > header.textEnd ||
+		   a.insertBytes > header.textEnd - a.insertStart ||
+		   a.deleteStart < header.textFront || a.deleteStart > header.textEnd ||
+		   a.deleteBytes > header.textEnd - a.deleteStart) {
+			m_actions.clear();
+			return false;
+		}
+	}
+	m_first = header.first;
+	m_current = header.current;
+	m_rootRedo = header.rootRedo;
+	m_rootNewest = header.rootNewest;
+	m_text.assign(data, header.textEnd - header.textFront);
+	m_textBase = m_textFront = header.textFront;
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxEditorUndo::setJournal(ofxEditorJournal *journal) {
+	m_journal = journal;
+}
+
+//--------------------------------------------------------------
+ofxEditorJournal* ofxEditorUndo::getJournal() {
+	return m_journal;
+}
+
+// PROTECTED
+
+//--------------------------------------------------------------
+ofxEditorUndo::Action* ofxEditorUndo::find(size_t id) {
+	if(id == npos || id < m_first || id >= m_first + m_actions.size()) {
+		return NULL;
+	}
+	return &m_actions[id - m_first];
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorUndo::store(const std::u32string &text, size_t &bytes) {
+	size_t start = textEnd();
+	wstring_append(m_text, text);
+	bytes = textEnd() - start;
+	return start;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorUndo::moveToEnd(size_t start, size_t bytes) {
+	size_t end = textEnd();
+	m_text.append(m_text, start - m_textBase, bytes);
+	return end;
+}
+
+//--------------------------------------------------------------
+size_t ofxEditorUndo::textEnd() const {
+	return m_textBase + m_text.size();
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#pragma once
+
+#include <string>
+#include <deque>
+#include <cstddef>
+
+class ofxEditorJournal;
+
+/// undo history tree
+///
+/// each action is a node whose parent is the action before it, undoing moves
+/// to the parent & a new action after an undo starts a new branch instead of
+/// discarding the undone actions so any earlier branch can still be redone
+///
+/// actions only store the inserted & deleted text, as UTF-8 in a single text
+/// arena, & are kept in order by id in a ring so the oldest action is evicted
+/// in O(1) when the history is over its byte or action budget, the arena
+/// space before the oldest action is reclaimed once it's more than half of
+/// the arena
+///
+/// actions whose parent has been evicted can't be undone as the text before
+/// them is no longer known
+///
+/// changes can be recorded to a journal for crash recovery, see setJournal()
+class ofxEditorUndo {
+
+	public:
+
+		ofxEditorUndo();
+
+		/// no action, ie. the parent of the first action
+		static const size_t npos = (size_t)-1;
+
+		/// undo action, type is up to the user aka ofxEditor::UndoActionType
+		struct Action {
+			int type;            //< action type
+			unsigned int pos;    //< text pos where the action starts
+			long timestamp;      //< timestamp of the last update
+			size_t insertLength; //< inserted text length in chars
+			size_t deleteLength; //< deleted text length in chars
+			size_t insertStart;  //< inserted text start in the arena
+			size_t insertBytes;  //< inserted text size in the arena
+			size_t deleteStart;  //< deleted text start in the arena
+			size_t deleteBytes;  //< deleted text size in the arena
+			size_t parent;       //< id of the action before this one or npos
+			size_t redo;         //< id of the child action redo follows or npos
+			size_t newest;       //< id of the newest child action or npos
+			size_t older;        //< id of the next older sibling or npos
+			size_t newer;        //< id of the next newer sibling or npos
+		};
+
+	/// \section Edit
+
+		/// add an action after the current action & make it current
+		void add(int type, unsigned int pos, const std::u32string &insertText,
+		         const std::u32string &deleteText, long timestamp);
+
+		/// get the current action if it's the most recently added action &
+		/// can be extended by the following append functions, otherwise NULL
+		Action* getExtendable();
+
+		/// append text to the inserted text of the current action
+		void appendInsertText(const std::u32string &text);
+
+		/// append text to the deleted text of the current action
+		void appendDeleteText(const std::u32string &text);
+
+		/// prepend text to the deleted text of the current action which now
+		/// starts at pos, aka backspacing
+		void prependDeleteText(const std::u32string &text, unsigned int pos);
+
+		/// evict the oldest actions until there are at most maxBytes of
+		/// history & maxActions actions, 0 for no action limit, the most
+		/// recently added action is always kept
+		void trim(size_t maxBytes, size_t maxActions);
+
+		/// clear all actions
+		void clear();
+
+	/// \section Undo & Redo
+
+		/// move to the parent of the current action,
+		/// returns the action to undo or NULL if there is nothing to undo
+		const Action* undo();
+
+		/// move to the child of the current action in the current branch,
+		/// returns the action to redo or NULL if there is nothing to redo
+		const Action* redo();
+
+		/// switch the branch redo follows to an older or newer sibling,
+		/// returns false if there is no other branch in that direction
+		bool switchBranch(bool older=true);
+
+		/// get the inserted text of an action
+		void getInsertText(const Action &action, std::u32string &text) const;
+
+		/// get the deleted text of an action
+		void getDeleteText(const Action &action, std::u32string &text) const;
+
+	/// \section Access
+
+		/// get an action by id, id must be between getFirst() & getFirst() +
+		/// size() - 1
+		const Action& get(size_t id) const;
+
+		/// get the id of the oldest action
+		size_t getFirst() const;
+
+		/// get the id of the current action or npos at the start of history
+		size_t getCurrent() const;
+
+		/// number of actions
+		size_t size() const;
+
+		/// is the history empty?
+		bool empty() const;
+
+		/// approximate history size in bytes, the arena & action nodes
+		size_t getNumBytes() const;
+
+	/// \section Save & Load
+
+		/// append the history to a binary blob, ie. a journal checkpoint,
+		/// the blob is only valid for the current build
+		void save(std::string &data) const;
+
+		/// replace the history with a blob from save(), returns false &
+		/// clears the history if the blob is invalid
+		bool load(const char *data, size_t size);
+
+		/// set a journal to record changes to or NULL to stop recording
+		void setJournal(ofxEditorJournal *journal);
+
+		/// get the current journal or NULL
+		ofxEditorJournal* getJournal();
+
+	protected:
+
+		std::deque<Action> m_actions; //< actions by id, oldest first
+		size_t m_first;       //< id of the oldest action
+		size_t m_current;     //< id of the current action or npos
+		size_t m_rootRedo;    //< id of the first action redo follows or npos
+		size_t m_rootNewest;  //< id of the newest action without a parent or npos
+		std::string m_text;   //< text arena
+		size_t m_textBase;    //< arena offset of m_text[0]
+		size_t m_textFront;   //< arena offset of the oldest text still in use
+		ofxEditorJournal *m_journal; //< journal to record changes to or NULL
+
+		/// get an action by id, NULL if it's been evicted or is npos
+		Action* find(size_t id);
+
+		/// append text to the arena, returns it's start & sets the size
+		size_t store(const std::u32string &text, size_t &bytes);
+
+		/// move a span of arena text to the end of the arena so it can be
+		/// extended, returns the new start
+		size_t moveToEnd(size_t start, size_t bytes);
+
+		/// end of the arena
+		size_t textEnd() const;
+};
@@ -418,7 +418,7 @@ void ofxFileDialog::keyPressedSaveAs(int key) {
 					return;
 
 				case OF_KEY_RETURN:
-					m_selectedPath = m_path + m_text;
+					m_selectedPath = m_path + m_text.getText();
 					break;
 					
 				case OF_KEY_ESC:
@@ -543,15 +543,15 @@ void ofxFileDialog::keyPressedNewFolder(int key, bool saveAs) {
 	switch(key) {
 
 		case OF_KEY_RETURN:
-			if(!ofDirectory::createDirectory(wstring_to_string(m_path+m_text))) {
-				ofLogError("ofxFileDialog") << "couldn't create new folder: \"" << wstring_to_string(m_text) << "\"";
+			if(!ofDirectory::createDirectory(wstring_to_string(m_path+m_text.getText()))) {
+				ofLogError("ofxFileDialog") << "couldn't create new folder: \"" << wstring_to_string(m_text.getText()) << "\"";
 				m_saveAsState = FILENAME;
 			}
 			else {
-				ofLogVerbose("ofxFileDialog") << "created new folder: \"" << wstring_to_string(m_text) << "\"";
+				ofLogVerbose("ofxFileDialog") << "created new folder: \"" << wstring_to_string(m_text.getText()) << "\"";
 				refresh();
 				for(int i = 0; i < m_filenames.size(); ++i) {
-					if(m_filenames[i] == m_text) {
+					if(m_filenames[i] == m_text.getText()) {
 						m_currentFile = i;
 						break;
 					}
@@ -28,6 +28,12 @@ ofxGLEditor::ofxGLEditor() {
 	bModifierPressed = false;
 	bHideEditor = false;
 	bFlashEvalSelection = false;
+	m_replListener.m_parent = this;
+	m_evalId = 0;
+	m_evalPending.resize(s_numEditors, 0);
+	m_evalRunning = -1;
+	m_evalCancelled = false;
+	m_evalThreadRunning = false;
 }
 
 //--------------------------------------------------------------
@@ -48,7 +54,7 @@ void ofxGLEditor::setup(ofxGLEditorListener *listener, bool enableRepl) {
 	// create editors
 	if(enableRepl) {
 		ofxRepl *repl = new ofxRepl(m_settings);
-		repl->setup(listener);
+		repl->setup(&m_replListener);
 		m_editors.push_back(repl);
 	}
 	else {
@@ -70,6 +76,7 @@ void ofxGLEditor::setup(ofxGLEditorListener *listener, bool enableRepl) {
 
 //--------------------------------------------------------------
 void ofxGLEditor::clear() {
+	stopEval();
 	m_listener = NULL;
 	for(int i = 0; i < (int) m_editors.size(); i++) {
 		if(m_editors[i] != NULL)
@@ -83,6 +90,15 @@ void ofxGLEditor::clear() {
 
 //--------------------------------------------------------------
 void ofxGLEditor::draw() {
+
+	printEvalResults();
+
+	// commit repl output & log messages even when the repl isn't shown
+	if(m_editors[0]) {
+		ofxRepl *repl = (ofxRepl*) m_editors[0];
+		repl->flush();
+	}
+
 	ofPushView();
 	ofPushMatrix();
 	ofPushStyle();
@@ -128,12 +144,19 @@ void ofxGLEditor::keyPressed(int key) {
 						m_editors[m_currentEditor]->flashSelection();
 					}
 					string script = getText();
-					if(m_listener) {
+					if(m_evalExecutor) {
+						startEval(m_currentEditor, script);
+					}
+					else if(m_listener) {
 						m_listener->executeScriptEvent(m_currentEditor);
 					}
 				}
 				return;
 			
+			case '.':
+				cancelEval();
+				return;
+			
 			case 't': case 20:
 				bHideEditor = !bHideEditor;
 				return;
@@ -177,6 +200,9 @@ void ofxGLEditor::keyPressed(int key) {
 				
 			case 'r': case '0': case 18: // Repl
 				if(m_editors[0]) {
+					if(m_currentEditor == 0 && key != '0' && !m_fileDialog->isActive()) {
+						break; // already there, Repl history search
+					}
 					m_currentEditor = 0;
 				}
 				return;
@@ -513,6 +539,23 @@ void ofxGLEditor::clearRepl() {
 	}
 }
 
+//--------------------------------------------------------------
+void ofxGLEditor::setReplHistoryFile(const std::string &path) {
+	if(m_editors[0]) {
+		ofxRepl *repl = (ofxRepl*) m_editors[0];
+		repl->setHistoryFile(path);
+	}
+}
+
+//--------------------------------------------------------------
+std::string ofxGLEditor::getReplHistoryFile() {
+	if(m_editors[0]) {
+		ofxRepl *repl = (ofxRepl*) m_editors[0];
+		return repl->getHistoryFile();
+	}
+	return "";
+}
+
 //--------------------------------------------------------------
 void ofxGLEditor::clearReplHistory() {
 	if(m_editors[0]) {
@@ -522,6 +565,67 @@ void ofxGLEditor::clearReplHistory() {
 	}
 }
 
+// ASYNC EVAL
+
+//--------------------------------------------------------------
+void ofxGLEditor::setEvalExecutor(EvalExecutor executor) {
+	bool replPending = m_evalPending[0] != 0;
+	stopEval();
+	m_evalExecutor = executor;
+	if(replPending) {
+		evalReplReturn();
+	}
+}
+
+//--------------------------------------------------------------
+bool ofxGLEditor::isAsyncEval() {
+	return (bool) m_evalExecutor;
+}
+
+//--------------------------------------------------------------
+bool ofxGLEditor::isEvalPending(int editor) {
+	editor = getEditorIndex(editor);
+	if(editor == -1) {
+		ofLogError("ofxGLEditor") << "cannot check eval of unknown editor " << editor;
+		return false;
+	}
+	return m_evalPending[editor] != 0;
+}
+
+//--------------------------------------------------------------
+void ofxGLEditor::cancelEval(int editor) {
+	editor = getEditorIndex(editor);
+	if(editor == -1) {
+		ofLogError("ofxGLEditor") << "cannot cancel eval of unknown editor " << editor;
+		return;
+	}
+	if(m_evalPending[editor] == 0) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_evalMutex);
+		for(size_t i = 0; i < m_evalJobs.size(); ++i) {
+			if(m_evalJobs[i].editor == editor) {
+				m_evalJobs.erase(m_evalJobs.begin()+i);
+				break;
+			}
+		}
+		if(m_evalRunning == editor) {
+			m_evalCancelled = true;
+		}
+	}
+	m_evalPending[editor] = 0; // discard the result if it's already running
+	ofLogVerbose("ofxGLEditor") << "cancelled eval of editor " << editor;
+	if(editor == 0) {
+		evalReplReturn();
+	}
+}
+
+//--------------------------------------------------------------
+bool ofxGLEditor::isEvalCancelled() {
+	return m_evalCancelled;
+}
+
 //--------------------------------------------------------------
 void ofxGLEditor::setPath(std::string path) {
 	// make sure there is a trailing /
@@ -654,6 +758,149 @@ ofxEditorSyntax* ofxGLEditor::getSyntax(int editor) {
 
 // PRIVATE
 
+//--------------------------------------------------------------
+void ofxGLEditor::startEval(int editor, const std::string &text) {
+	unsigned long id = ++m_evalId;
+	{
+		std::lock_guard<std::mutex> lock(m_evalMutex);
+		if(!m_evalThreadRunning) {
+			m_evalThreadRunning = true;
+			m_evalThread = std::thread(&ofxGLEditor::runEval, this);
+		}
+		
+		// supersede the editor's pending eval, there's at most one queued
+		if(m_evalPending[editor] != 0) {
+			for(size_t i = 0; i < m_evalJobs.size(); ++i) {
+				if(m_evalJobs[i].editor == editor) {
+					m_evalJobs.erase(m_evalJobs.begin()+i);
+					break;
+				}
+			}
+			if(m_evalRunning == editor) {
+				m_evalCancelled = true;
+			}
+		}
+		
+		EvalJob job;
+		job.id = id;
+		job.editor = editor;
+		job.text = text;
+		m_evalJobs.push_back(std::move(job));
+	}
+	m_evalCondition.notify_one();
+	m_evalPending[editor] = id;
+	if(editor == 0 && m_editors[0]) {
+		ofxRepl *repl = (ofxRepl*) m_editors[0];
+		repl->setEvalPending();
+	}
+}
+
+//--------------------------------------------------------------
+void ofxGLEditor::printEvalResults() {
+	std::deque<EvalResult> results;
+	{
+		std::lock_guard<std::mutex> lock(m_evalMutex);
+		if(m_evalResults.empty()) {
+			return;
+		}
+		results.swap(m_evalResults);
+	}
+	for(size_t i = 0; i < results.size(); ++i) {
+		EvalResult &result = results[i];
+		if(m_evalPending[result.editor] != result.id) {
+			continue; // superseded or cancelled
+		}
+		m_evalPending[result.editor] = 0;
+		if(result.editor == 0) {
+			evalReplReturn(result.text);
+		}
+		else if(!result.success) {
+			ofLogError("ofxGLEditor") << "editor " << result.editor << ": " << result.text;
+		}
+		else if(!result.text.empty() && m_editors[0]) {
+			ofxRepl *repl = (ofxRepl*) m_editors[0];
+			repl->print(result.text, true);
+			if(result.text[result.text.size()-1] != '\n') {
+				repl->print("\n", true);
+			}
+		}
+		if(m_listener) {
+			m_listener->evalCompleteEvent(result.editor, result.success, result.text);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void ofxGLEditor::stopEval() {
+	{
+		std::lock_guard<std::mutex> lock(m_evalMutex);
+		m_evalThreadRunning = false;
+		m_evalJobs.clear();
+		m_evalCancelled = true;
+	}
+	m_evalCondition.notify_one();
+	if(m_evalThread.joinable()) {
+		m_evalThread.join();
+	}
+	m_evalResults.clear();
+	m_evalRunning = -1;
+	m_evalCancelled = false;
+	m_evalPending.assign(s_numEditors, 0);
+	if(!m_editors.empty() && m_editors[0]) {
+		ofxRepl *repl = (ofxRepl*) m_editors[0];
+		repl->setEvalPending(false);
+	}
+}
+
+//--------------------------------------------------------------
+void ofxGLEditor::runEval() {
+	std::unique_lock<std::mutex> lock(m_evalMutex);
+	while(true) {
+		while(m_evalThreadRunning && m_evalJobs.empty()) {
+			m_evalCondition.wait(lock);
+		}
+		if(!m_evalThreadRunning) {
+			break;
+		}
+		EvalJob job = std::move(m_evalJobs.front());
+		m_evalJobs.pop_front();
+		m_evalRunning = job.editor;
+		m_evalCancelled = false;
+		lock.unlock();
+		
+		EvalResult result;
+		result.id = job.id;
+		result.editor = job.editor;
+		try {
+			result.success = m_evalExecutor(job.text, job.editor, result.text);
+		}
+		catch(std::exception &e) {
+			result.success = false;
+			result.text = e.what();
+		}
+		
+		lock.lock();
+		m_evalRunning = -1;
+		if(!m_evalCancelled) {
+			m_evalResults.push_back(std::move(result));
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void ofxGLEditor::ReplListener::evalReplEvent(const std::string &text) {
+	if(m_parent->m_evalExecutor) {
+		m_parent->startEval(0, text);
+	}
+	else if(m_parent->m_listener) {
+		m_parent->m_listener->evalReplEvent(text);
+	}
+	else {
+		ofLogWarning("ofxGLEditor") << "listener not set";
+		m_parent->evalReplReturn();
+	}
+}
+
 //--------------------------------------------------------------
 int ofxGLEditor::getEditorIndex(int editor) {
 	if(editor < 0 || (editor - 1) >= (int) m_editors.size()) {
@@ -22,6 +22,13 @@
 #include "ofxRepl.h"
 #include "ofxFileDialog.h"
 
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
 /// multi editor event listener
 class ofxGLEditorListener : public ofxReplListener {
 	
@@ -42,6 +49,11 @@ class ofxGLEditorListener : public ofxReplListener {
 		/// this event is triggered when Enter is pressed in the Repl console
 		/// returns the text to be evaluated
 		virtual void evalReplEvent(const std::string &text) {}
+	
+		/// triggered when an async eval finishes, see setEvalExecutor()
+		/// returns the index of the editor (0 for the Repl), whether the
+		/// eval succeeded, & the result or error message
+		virtual void evalCompleteEvent(int &whichEditor, bool success, const std::string &result) {}
 };
 
 /// 9 text editor buffers with a live optional Read-Eval-Print Loop,
@@ -75,12 +87,14 @@ class ofxGLEditor {
 		///        ofxEditor::setSuperAsModifier()
 		///
 		/// MOD + t: toggle whether to show or hide the editor
-		/// MOD + r & MOD + 0: switch to REPL (console), if enabled
+		/// MOD + r & MOD + 0: switch to REPL (console), if enabled,
+		///                    MOD + r in the REPL searches the history
 		/// MOD + 1 to MOD + 9: switch to editor 1 - 9
 		///
 		/// ARROWS + SHIFT: select text
 		///
-		/// MOD + e: trigger an executeScript event
+		/// MOD + e: trigger an executeScript event or an async eval
+		/// MOD + .: cancel the current editor's pending async eval
 		/// MOD + b: blow up the cursor
 		/// MOD + a: select all text in the current editor
 		/// MOD + a + SHIFT: clear all text in the current editor
@@ -93,6 +107,7 @@ class ofxGLEditor {
 		///
 		/// MOD + z: undo last key input action
 		/// MOD + y: redo last key input action
+		/// MOD + y + SHIFT: redo the next older branch of undone actions
 		///
 		/// MOD + -: decrease current editor alpha
 		/// MOD + =: increase current editor alpha
@@ -208,6 +223,60 @@ class ofxGLEditor {
 		/// clears Repl history, does not clear buffer text
 		void clearReplHistory();
 	
+		/// set the Repl history file, relative to the data path, the history
+		/// is loaded on first use & each command is appended, set an empty
+		/// path to only keep the history in memory (default)
+		///
+		/// note: this does nothing if the repl was not enabled in setup()
+		void setReplHistoryFile(const std::string &path);
+	
+		/// get the Repl history file path, returns "" if not set
+		std::string getReplHistoryFile();
+	
+	/// \section Async Eval
+	
+		/// async eval executor, called on the eval thread with a copy of the
+		/// text to evaluate & the index of the editor it's from (0 for the
+		/// Repl), set the result or error message & return true on success or
+		/// false on error, exceptions are caught & treated as errors
+		///
+		/// note: the executor must not touch the editor or draw
+		typedef std::function<bool(const std::string &text, int editor, std::string &result)> EvalExecutor;
+	
+		/// set an executor to evaluate editor scripts & Repl commands on a
+		/// background thread instead of sending executeScript & evalRepl
+		/// events so heavy evals don't stall drawing, set an empty executor
+		/// to go back to events
+		///
+		/// evals run one at a time & the results are delivered in order by
+		/// draw(): Repl results are printed via evalReplReturn(), editor
+		/// results are printed above the Repl prompt & editor errors are
+		/// logged, then an evalCompleteEvent is sent
+		///
+		/// a new eval from the same editor supersedes its pending eval, which
+		/// is dropped if it hasn't started or its result is discarded if it
+		/// has, the Repl shows a pending indicator & waits for the result
+		/// before the next command
+		///
+		/// note: waits for the running eval to finish
+		void setEvalExecutor(EvalExecutor executor);
+	
+		/// is async eval enabled?
+		bool isAsyncEval();
+	
+		/// is an async eval of an editor pending?
+		/// set editor to 0 for the current editor
+		bool isEvalPending(int editor=0);
+	
+		/// cancel the pending async eval of an editor, the result is discarded
+		/// if it's already running & the Repl prints the next prompt
+		/// set editor to 0 for the current editor
+		void cancelEval(int editor=0);
+	
+		/// has the running eval been superseded or cancelled? call from the
+		/// executor to stop long evals early, the result is discarded anyway
+		bool isEvalCancelled();
+	
 	/// \section Display Settings
 
 		/// access to the internal settings object
@@ -321,6 +390,26 @@ class ofxGLEditor {
 		/// returns -1 if index out of bounds
 		int getEditorIndex(int editor);
 	
+		/// queue an async eval, superseding the editor's pending eval
+		void startEval(int editor, const std::string &text);
+	
+		/// print queued async eval results, called by draw()
+		void printEvalResults();
+	
+		/// stop the eval thread & drop pending evals
+		void stopEval();
+	
+		/// eval thread loop
+		void runEval();
+	
+		/// forwards Repl evals to the eval thread or the listener
+		class ReplListener : public ofxReplListener {
+			public:
+				ofxGLEditor *m_parent;
+				void evalReplEvent(const std::string &text);
+		};
+		ReplListener m_replListener;
+	
 		ofxGLEditorListener *m_listener; //< event listener
 	
 		ofxEditorSettings m_settings; //< shared editor settings
@@ -335,4 +424,33 @@ class ofxGLEditor {
 		bool bHideEditor;     //< hide the editor?
 	
 		bool bFlashEvalSelection; //< flash selection on eval?
+	
+		/// async eval request
+		struct EvalJob {
+			unsigned long id; //< eval id, higher is newer
+			int editor;       //< editor index, 0 for the Repl
+			std::string text; //< text to evaluate
+		};
+	
+		/// async eval result
+		struct EvalResult {
+			unsigned long id;
+			int editor;
+			bool success;       //< did the eval succeed?
+			std::string text;   //< result or error message
+		};
+	
+		EvalExecutor m_evalExecutor; //< async eval executor, empty when disabled
+		unsigned long m_evalId; //< last eval id
+		std::vector<unsigned long> m_evalPending; //< pending eval id per editor, 0 for none
+	
+		// shared with the eval thread
+		std::mutex m_evalMutex;
+		std::condition_variable m_evalCondition;
+		std::thread m_evalThread;
+		std::deque<EvalJob> m_evalJobs;       //< evals waiting to run
+		std::deque<EvalResult> m_evalResults; //< results waiting to be printed
+		int m_evalRunning;                    //< editor of the running eval or -1
+		std::atomic<bool> m_evalCancelled;    //< was the running eval superseded?
+		bool m_evalThreadRunning;             //< is the eval thread running?
 };
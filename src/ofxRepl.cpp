@@ -24,14 +24,26 @@
 
 #include "Unicode.h"
 
-#define MAX_TEXT_LINES	256
-#define MAX_HISTORY_LEN	256
+#include <chrono>
+
+// log messages queued from other threads between frames
+#define LOG_QUEUE_SIZE 1024
+
+// how long a thread logging into a full queue waits for room before the
+// message is dropped, aka backpressure without deadlocking if the owner
+// thread is waiting on the logging thread
+#define LOG_QUEUE_WAIT_MS 100
+
+// eval pending indicator animation speed
+#define EVAL_PENDING_DOTS_PER_SEC 4
 
 // utils
 bool isEmpty(u32string s);
 
 std::u32string ofxRepl::s_banner = U"";
 std::u32string ofxRepl::s_prompt = U"> ";
+unsigned int ofxRepl::s_maxLines = 256;
+size_t ofxRepl::s_maxChars = 65536;
 
 //--------------------------------------------------------------
 ofxRepl::ofxRepl() : ofxEditor() {
@@ -39,8 +51,14 @@ ofxRepl::ofxRepl() : ofxEditor() {
 	m_promptPos = 0;
 	m_selectAllStartPos = 0;
 	m_insertPos = 0;
+	m_historyPos = 0;
 	m_historyNavStarted = false;
+	m_searching = false;
+	m_searchUTF8Bytes = 0;
+	m_searchPos = ofxReplHistory::npos;
 	m_linePos = 0;
+	m_pendingBeforePrompt = false;
+	m_evalPending = false;
 }
 
 //--------------------------------------------------------------
@@ -49,8 +67,14 @@ ofxRepl::ofxRepl(ofxEditorSettings &sharedSettings) : ofxEditor(sharedSettings)
 	m_promptPos = 0;
 	m_selectAllStartPos = 0;
 	m_insertPos = 0;
+	m_historyPos = 0;
 	m_historyNavStarted = false;
+	m_searching = false;
+	m_searchUTF8Bytes = 0;
+	m_searchPos = ofxReplHistory::npos;
 	m_linePos = 0;
+	m_pendingBeforePrompt = false;
+	m_evalPending = false;
 }
 
 //--------------------------------------------------------------
@@ -62,8 +86,7 @@ ofxRepl::~ofxRepl() {
 void ofxRepl::setup() {
 
 	// setup our custom logger
-	m_logger = std::shared_ptr<Logger>(new Logger);
-	m_logger->m_parent = this;
+	m_logger = std::shared_ptr<Logger>(new Logger(this));
 	ofSetLoggerChannel(m_logger);
 
 	// print greeting and first prompt
@@ -80,9 +103,57 @@ void ofxRepl::setup(ofxReplListener *listener) {
 	m_listener = listener;
 }
 
+//--------------------------------------------------------------
+void ofxRepl::draw() {
+	flush();
+	ofxEditor::draw();
+	
+	// search text in the top right while searching the history
+	if(m_searching) {
+		std::u32string search = U"search: " + string_to_wstring(m_searchText);
+		if(m_searchPos == ofxReplHistory::npos && !m_searchText.empty()) {
+			search = U"failed " + search;
+		}
+		ofPushStyle();
+		ofSetColor(m_settings->getTextColor(), (int)(m_settings->getAlpha()*255));
+		drawString(search, m_width - s_font->stringWidth(search) - s_charWidth*2, 0);
+		ofPopStyle();
+	}
+	
+	// animated dots in the top right while waiting for an eval
+	else if(m_evalPending) {
+		std::u32string dots(1 + (int)(ofGetElapsedTimef()*EVAL_PENDING_DOTS_PER_SEC) % 3, '.');
+		ofPushStyle();
+		ofSetColor(m_settings->getTextColor(), (int)(m_settings->getAlpha()*255));
+		drawString(dots, m_width - s_charWidth*4, 0);
+		ofPopStyle();
+	}
+}
+
+//--------------------------------------------------------------
+void ofxRepl::flush() {
+	printLogMessages();
+	printPending();
+}
+
+//--------------------------------------------------------------
+void ofxRepl::printLogMessages() {
+	if(m_logger) {
+		m_logger->printQueued();
+	}
+}
+
 //--------------------------------------------------------------
 void ofxRepl::keyPressed(int key) {
 	
+	// key events work on what's shown
+	flush();
+	
+	// the command line is done until the eval returns
+	if(m_evalPending) {
+		return;
+	}
+	
 	// filter out modifier key events, except SHIFT
 	switch(key) {
 		case OF_KEY_ALT: case OF_KEY_LEFT_ALT: case OF_KEY_RIGHT_ALT:
@@ -94,6 +165,18 @@ void ofxRepl::keyPressed(int key) {
 	
 	// check modifier keys
 	bool modifierPressed = ofxEditor::getSuperAsModifier() ? ofGetKeyPressed(OF_KEY_SUPER) : ofGetKeyPressed(OF_KEY_CONTROL);
+	if(modifierPressed && (key == 'r' || key == 18)) {
+		historySearch();
+		return;
+	}
+	
+	// keys edit the search text while searching the history
+	if(m_searching) {
+		if(!modifierPressed && historySearchKey(key)) {
+			return;
+		}
+		m_searching = false; // use the match
+	}
 	if(modifierPressed) {
 		switch(key) {
 			case 'a': case 10: // select all / clear all text
@@ -177,55 +260,22 @@ void ofxRepl::keyPressed(int key) {
 
 //--------------------------------------------------------------
 void ofxRepl::print(const std::u32string &what, bool beforePrompt) {
-
-	// trim half of text if we overflow the max num of lines
-	if(m_numLines > MAX_TEXT_LINES) {
-		int line = (int)m_numLines*0.25;
-		int count = 0;
-		int pos = 0;
-		for(unsigned int i = 0; count <= line && i < m_text.size(); i++) {
-			if(m_text[i] == '\n') {
-				count++;
-				pos = i+1;
-			}
-		}
-		m_text.erase(0, pos);
-		textBufferUpdated();
-		m_position = m_promptPos = m_insertPos = m_text.size();
-		m_topTextPosition -= pos;
-		m_bottomTextPosition -= pos;
-	}
-
-	std::u32string to_print;
-	for(std::u32string::const_iterator i = what.begin(); i != what.end(); ++i) {
-		m_linePos++;
-		if(*i == '\n') {
-			m_linePos = 0;
-		}
-		to_print += *i;
+	if(what.empty()) {
+		return;
 	}
 	
-	if(beforePrompt) {
-		m_text.insert(MAX(0, m_promptPos-s_prompt.length()), to_print);
-		m_position += to_print.length();
-		m_promptPos += to_print.length();
-		m_insertPos += to_print.length();
-		m_selectAllStartPos += to_print.length();
-		if(m_selection != NONE) {
-			m_highlightStart += to_print.length();
-			m_highlightEnd += to_print.length();
-		}
-	}
-	else {
-		insertText(to_print);
-		m_promptPos = m_insertPos;
-		m_promptPos = m_position+s_prompt.length();
-		m_selectAllStartPos = m_position;
-		m_highlightStart = m_position;
-		m_highlightEnd = m_position;
+	// text printed above & after the prompt go to different positions, so
+	// commit when switching to keep the order
+	if(!m_pendingText.empty() && m_pendingBeforePrompt != beforePrompt) {
+		printPending();
 	}
+	m_pendingText += what;
+	m_pendingBeforePrompt = beforePrompt;
 	
-	keepCursorVisible();
+	// the oldest lines would be removed anyway, don't let a flood pile up
+	if(m_pendingText.size() > s_maxChars) {
+		printPending();
+	}
 }
 
 //--------------------------------------------------------------
@@ -235,6 +285,7 @@ void ofxRepl::print(const std::string &what, bool beforePrompt) {
 
 //--------------------------------------------------------------
 void ofxRepl::printEvalReturn(const std::u32string &what) {
+	m_evalPending = false;
 	if(what.size() > 0) {
 		print(what+U"\n");
 	}
@@ -246,8 +297,19 @@ void ofxRepl::printEvalReturn(const std::string &what) {
 	printEvalReturn(string_to_wstring(what));
 }
 
+//--------------------------------------------------------------
+void ofxRepl::setEvalPending(bool pending) {
+	m_evalPending = pending;
+}
+
+//--------------------------------------------------------------
+bool ofxRepl::isEvalPending() {
+	return m_evalPending;
+}
+
 //--------------------------------------------------------------
 void ofxRepl::clearText() {
+	m_pendingText.clear();
 	ofxEditor::clearText();
 	m_promptPos = 0;
 	m_selectAllStartPos = 0;
@@ -260,6 +322,23 @@ void ofxRepl::clearHistory() {
 	historyClear();
 }
 
+//--------------------------------------------------------------
+void ofxRepl::setHistoryFile(const std::string &path) {
+	m_historyNavStarted = false;
+	m_searching = false;
+	m_history.setFile(path.empty() ? path : ofToDataPath(path));
+}
+
+//--------------------------------------------------------------
+const std::string& ofxRepl::getHistoryFile() {
+	return m_history.getFile();
+}
+
+//--------------------------------------------------------------
+ofxReplHistory& ofxRepl::getHistory() {
+	return m_history;
+}
+
 //--------------------------------------------------------------
 bool ofxRepl::openFile(std::string filename) {
 	ofLogWarning("ofxRepl") << "ignoring openFile";
@@ -293,11 +372,7 @@ void ofxRepl::eval() {
 			if(defun[defun.length()-1] == '\n') {
 				defun.resize(defun.length()-1, 0);
 			}
-			if(m_history.size() >= MAX_HISTORY_LEN) {
-				m_history.pop_front();
-				m_historyIter--;
-			}
-			m_history.push_back(defun);
+			m_history.add(defun);
 			m_historyNavStarted = false;
 		
 			// go to next line in case the listener isn't set
@@ -308,8 +383,52 @@ void ofxRepl::eval() {
 	}
 }
 
+//--------------------------------------------------------------
+void ofxRepl::printPending() {
+	if(m_pendingText.empty()) {
+		return;
+	}
+	const std::u32string &what = m_pendingText;
+	
+	// chars since the last line break
+	size_t lastBreak = what.rfind('\n');
+	if(lastBreak == std::u32string::npos) {
+		m_linePos += what.size();
+	}
+	else {
+		m_linePos = what.size() - lastBreak - 1;
+	}
+	
+	if(m_pendingBeforePrompt) {
+		m_text.insert(MAX(0, m_promptPos-s_prompt.length()), what);
+		m_position += what.length();
+		m_promptPos += what.length();
+		m_insertPos += what.length();
+		m_selectAllStartPos += what.length();
+		if(m_selection != NONE) {
+			m_highlightStart += what.length();
+			m_highlightEnd += what.length();
+		}
+		textBufferUpdated();
+	}
+	else {
+		insertText(what);
+		m_promptPos = m_insertPos;
+		m_promptPos = m_position+s_prompt.length();
+		m_selectAllStartPos = m_position;
+		m_highlightStart = m_position;
+		m_highlightEnd = m_position;
+	}
+	
+	m_pendingText.clear();
+	
+	trimLines();
+	keepCursorVisible();
+}
+
 //--------------------------------------------------------------
 void ofxRepl::printPrompt() {
+	printPending();
 	m_insertPos = m_text.length();
 	if(m_text.length() > 0 && m_text[m_insertPos-1] != '\n') {
 		m_text += '\n';
@@ -324,9 +443,10 @@ void ofxRepl::printPrompt() {
 //--------------------------------------------------------------
 void ofxRepl::historyClear() {
 	m_historyNavStarted = false;
+	m_searching = false;
 	m_history.clear();
 	m_insertPos = 0;
-	m_historyIter = m_history.end();
+	m_historyPos = 0;
 	m_historyPresent = m_text.substr(m_promptPos);
 }
 
@@ -334,29 +454,34 @@ void ofxRepl::historyClear() {
 void ofxRepl::historyPrev() {
 	
 	if(!m_historyNavStarted) {
-		m_historyIter = m_history.end();
+		m_historyPos = m_history.size();
 		m_historyNavStarted = true;
 	}
 
-	if(m_historyIter == m_history.end()) {
+	if(m_historyPos == m_history.size()) {
 		m_historyPresent = m_text.substr(m_promptPos);
 	}
 
-	if(m_historyIter == m_history.begin()) {
+	// only step through lines starting with the live input
+	size_t prev = m_history.findPrefix(m_historyPresent, m_historyPos);
+	if(prev == ofxReplHistory::npos) {
 		return;
 	}
 
-	m_historyIter--;
-	historyShow(*m_historyIter);
+	m_historyPos = prev;
+	historyShow(m_history.get(m_historyPos));
 }
 
 //--------------------------------------------------------------
 void ofxRepl::historyNext() {
-	if(!m_historyNavStarted || (m_historyIter == m_history.end())) {
+	if(!m_historyNavStarted || (m_historyPos == m_history.size())) {
 		return;
 	}
-	m_historyIter++;
-	historyShow((m_historyIter == m_history.end()) ? m_historyPresent : *m_historyIter);
+	m_historyPos = m_history.findPrefixNewer(m_historyPresent, m_historyPos);
+	if(m_historyPos == ofxReplHistory::npos) {
+		m_historyPos = m_history.size();
+	}
+	historyShow((m_historyPos == m_history.size()) ? m_historyPresent : m_history.get(m_historyPos));
 }
 
 //--------------------------------------------------------------
@@ -366,6 +491,114 @@ void ofxRepl::historyShow(std::u32string what) {
 	m_position = m_text.length();
 }
 
+//--------------------------------------------------------------
+void ofxRepl::historySearch() {
+	if(!m_searching) {
+		m_searching = true;
+		m_searchText = "";
+		m_searchUTF8Bytes = 0;
+		m_searchPos = ofxReplHistory::npos;
+		m_historyPresent = m_text.substr(m_promptPos);
+		m_historyNavStarted = false;
+		return;
+	}
+	
+	// next older match
+	if(m_searchPos == ofxReplHistory::npos) {
+		return;
+	}
+	size_t found = m_history.find(string_to_wstring(m_searchText), m_searchPos);
+	if(found != ofxReplHistory::npos) {
+		m_searchPos = found;
+		historyShow(m_history.get(m_searchPos));
+	}
+}
+
+//--------------------------------------------------------------
+bool ofxRepl::historySearchKey(int key) {
+	switch(key) {
+		case OF_KEY_SHIFT: case OF_KEY_LEFT_SHIFT: case OF_KEY_RIGHT_SHIFT:
+			return true;
+		case OF_KEY_ESC: // cancel
+			m_searching = false;
+			historyShow(m_historyPresent);
+			return true;
+		case OF_KEY_BACKSPACE: // remove the last char
+			if(m_searchText.empty()) {
+				return true;
+			}
+			while(m_searchText.size() > 1 && (m_searchText.back() & 0xC0) == 0x80) {
+				m_searchText.pop_back(); // UTF-8 continuation bytes
+			}
+			m_searchText.pop_back();
+			m_searchUTF8Bytes = 0;
+			break;
+		default:
+			if(key >= ' ' && key < OF_KEY_DEL) {
+				m_searchText.push_back(key);
+				m_searchUTF8Bytes = 0;
+			}
+			else if(key >= 0x80 && key < 0x100) { // build multibyte UTF-8 char
+				if(m_searchUTF8Bytes == 0) {
+					m_searchUTF8Bytes = wchar_width(key);
+				}
+				m_searchText.push_back(key);
+				if(--m_searchUTF8Bytes > 0) {
+					return true;
+				}
+			}
+			else {
+				return false; // use the match & handle the key as usual
+			}
+			break;
+	}
+	
+	// search from the newest line as the text changed
+	m_searchPos = ofxReplHistory::npos;
+	if(!m_searchText.empty()) {
+		m_searchPos = m_history.find(string_to_wstring(m_searchText));
+	}
+	historyShow(m_searchPos == ofxReplHistory::npos ? m_historyPresent : m_history.get(m_searchPos));
+	return true;
+}
+
+//--------------------------------------------------------------
+void ofxRepl::trimLines() {
+	size_t lines = m_text.getNumLineBreaks()+1;
+	size_t chars = m_text.size();
+	if(lines <= s_maxLines && chars <= s_maxChars) {
+		return;
+	}
+	
+	// start of the first line to keep, never past the prompt line
+	size_t keepLines = s_maxLines - s_maxLines/4;
+	size_t keepChars = s_maxChars - s_maxChars/4;
+	size_t line = (lines > keepLines ? lines - keepLines : 0);
+	if(chars > keepChars) {
+		line = std::max(line, m_text.getLineForPos(chars - keepChars) + 1);
+	}
+	size_t promptStart = (m_promptPos > s_prompt.length() ? m_promptPos - s_prompt.length() : 0);
+	line = std::min(line, m_text.getLineForPos(promptStart));
+	unsigned int pos = m_text.getLineStart(line);
+	if(pos == 0) {
+		return;
+	}
+	
+	// free the removed text
+	m_text.erase(0, pos);
+	m_text.compact();
+	
+	m_position = (m_position > pos ? m_position - pos : 0);
+	m_promptPos = (m_promptPos > pos ? m_promptPos - pos : 0);
+	m_insertPos = (m_insertPos > pos ? m_insertPos - pos : 0);
+	m_selectAllStartPos = (m_selectAllStartPos > pos ? m_selectAllStartPos - pos : 0);
+	m_highlightStart = (m_highlightStart > pos ? m_highlightStart - pos : 0);
+	m_highlightEnd = (m_highlightEnd > pos ? m_highlightEnd - pos : 0);
+	m_topTextPosition = (m_topTextPosition > pos ? m_topTextPosition - pos : 0);
+	m_bottomTextPosition = (m_bottomTextPosition > pos ? m_bottomTextPosition - pos : 0);
+	textBufferUpdated();
+}
+
 //--------------------------------------------------------------
 void ofxRepl::keepCursorVisible() {
 
@@ -373,7 +606,7 @@ void ofxRepl::keepCursorVisible() {
 	int curVisLine = 0;
 	size_t step = 0;
 	for(unsigned int i = m_topTextPosition;
-	    i < m_position && (step = m_text.find('\n', i)) != std::u32string::npos;
+	    i < m_position && (step = m_text.find('\n', i)) != ofxEditorBuffer::npos;
 		i = step+1) {
 		curVisLine++;
 	}
@@ -428,13 +661,83 @@ std::string ofxRepl::getReplPrompt() {
 	return wstring_to_string(s_prompt);
 }
 
+//--------------------------------------------------------------
+void ofxRepl::setMaxLines(unsigned int lines) {
+	s_maxLines = std::max(lines, 1u);
+}
+
+//--------------------------------------------------------------
+unsigned int ofxRepl::getMaxLines() {
+	return s_maxLines;
+}
+
+//--------------------------------------------------------------
+void ofxRepl::setMaxChars(size_t chars) {
+	s_maxChars = std::max(chars, (size_t)1);
+}
+
+//--------------------------------------------------------------
+size_t ofxRepl::getMaxChars() {
+	return s_maxChars;
+}
+
 // PRIVATE
 
+//--------------------------------------------------------------
+ofxRepl::Logger::Logger(ofxRepl *parent) : m_queue(LOG_QUEUE_SIZE) {
+	m_parent = parent;
+	m_owner = std::this_thread::get_id();
+	m_dropped = 0;
+}
+
 //--------------------------------------------------------------
 void ofxRepl::Logger::log(ofLogLevel level, const std::string & module, const std::string & message){
 	ofConsoleLoggerChannel::log(level, module, message);
-	if(level >= ofGetLogLevel()) {
-		m_parent->print(string_to_wstring(message)+U"\n", true);
+	if(level < ofGetLogLevel()) {
+		return;
+	}
+	if(std::this_thread::get_id() == m_owner) {
+		printQueued(); // keep the order
+		std::u32string text;
+		text.reserve(message.size()+1);
+		string_append(text, message);
+		text.push_back('\n');
+		m_parent->print(text, true);
+		return;
+	}
+
+	// other threads can't touch the text buffer, queue for the owner
+	std::string queued = message;
+	if(m_queue.push(queued)) {
+		return;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	do {
+		if(std::chrono::steady_clock::now() - start > std::chrono::milliseconds(LOG_QUEUE_WAIT_MS)) {
+			m_dropped++;
+			return;
+		}
+		std::this_thread::yield();
+	} while(!m_queue.push(queued));
+}
+
+//--------------------------------------------------------------
+void ofxRepl::Logger::printQueued() {
+
+	// print at most one queue's worth so flooding threads can't stall the
+	// owner, the rest is printed next time
+	std::string message;
+	std::u32string text;
+	for(size_t i = 0; i < m_queue.capacity() && m_queue.pop(message); ++i) {
+		string_append(text, message);
+		text.push_back('\n');
+	}
+	size_t dropped = m_dropped.exchange(0);
+	if(dropped > 0) {
+		string_append(text, "dropped " + ofToString(dropped) + " log messages\n");
+	}
+	if(!text.empty()) {
+		m_parent->print(text, true);
 	}
 }
 
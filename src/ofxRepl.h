@@ -23,6 +23,8 @@
 #pragma once
 
 #include "ofxEditor.h"
+#include "ofxEditorQueue.h"
+#include "ofxReplHistory.h"
 
 /// repl event listener
 class ofxReplListener {
@@ -49,6 +51,24 @@ class ofxRepl : public ofxEditor {
 		/// prints greeting and first prompt
 		/// set listener to receive eval events
 		void setup(ofxReplListener *listener);
+	
+		/// draw the console, flushes pending output first
+		void draw();
+	
+		/// print queued log messages & commit pending output to the console,
+		/// called by draw() & before handling key events
+		///
+		/// printed text is accumulated & committed in a single batch so heavy
+		/// output is only laid out & highlighted once per frame
+		void flush();
+	
+		/// print log messages queued by other threads, called by draw() so
+		/// only needed when the console isn't drawn every frame
+		///
+		/// log messages from the thread which called setup() are printed
+		/// right away, messages from other threads are queued & printed in
+		/// a batch by the setup() thread
+		void printLogMessages();
 		
 		/// handles key events
 		///
@@ -57,20 +77,26 @@ class ofxRepl : public ofxEditor {
 		///
 		/// MOD + a + SHIFT: clear console
 		/// MOD + c + SHIFT: clear console history
+		/// MOD + r: reverse search the command history, type to search,
+		///          MOD + r again for the next older match, ESC to cancel,
+		///          any other key uses the match
 		///
-		/// UP & DOWN: step through command history
+		/// UP & DOWN: step through command history, only the commands
+		///            starting with the typed text if any
 		/// RETURN: eval current command
 		///
+		/// keys are ignored while an eval is pending
 		/// Undo works for the current command line
 		///
 		void keyPressed(int key);
 		
-		/// add a wide string to the console,
+		/// add a wide string to the console, committed with the next flush(),
 		/// set beforePrompt to true to print a line above the current prompt
 		void print(const std::u32string &what, bool beforePrompt=false);
 	
-		/// add a string to the console with string conversion,
-		/// set beforePrompt to true to print a line above the current prompt
+		/// add a string to the console with string conversion, committed with
+		/// the next flush(), set beforePrompt to true to print a line above the
+		/// current prompt
 		void print(const std::string &what, bool beforePrompt=false);
 		
 		/// add a wide string to the console and print a return after
@@ -79,12 +105,31 @@ class ofxRepl : public ofxEditor {
 		/// add a string to the console and print a return after with string conversion
 		void printEvalReturn(const std::string &what);
 		
+		/// set whether an eval is waiting for its return, ie. async eval,
+		/// shows a pending indicator & ignores keys until the next
+		/// printEvalReturn()
+		void setEvalPending(bool pending=true);
+	
+		/// is an eval waiting for its return?
+		bool isEvalPending();
+		
 		/// clear the console
 		void clearText();
 		
 		/// clear the command history
 		void clearHistory();
 	
+		/// set the command history file, loaded on first use & appended to
+		/// for each command, set an empty path to only keep the history in
+		/// memory (default)
+		void setHistoryFile(const std::string &path);
+	
+		/// get the command history file path
+		const std::string& getHistoryFile();
+	
+		/// access to the command history, ie. to set the max size
+		ofxReplHistory& getHistory();
+	
 		bool openFile(std::string filename); //< dummy implementation
 		bool saveFile(std::string filename); //< dummy implementation
 
@@ -101,6 +146,16 @@ class ofxRepl : public ofxEditor {
 		static void setReplPrompt(const std::string &text); //< call this before setup()
 		static std::u32string& getWideReplPrompt();
 		static std::string getReplPrompt();
+	
+		/// set/get the max number of console lines kept, the oldest lines
+		/// are removed in batches when over, default: 256
+		static void setMaxLines(unsigned int lines);
+		static unsigned int getMaxLines();
+	
+		/// set/get the max number of console chars kept, the oldest lines
+		/// are removed in batches when over, default: 65536
+		static void setMaxChars(size_t chars);
+		static size_t getMaxChars();
 
 	protected:
 	
@@ -110,7 +165,21 @@ class ofxRepl : public ofxEditor {
 		void historyNext();
 		void historyClear();
 		void historyShow(std::u32string what);
+	
+		/// start a reverse history search or find the next older match
+		void historySearch();
+	
+		/// handle a key during a reverse history search,
+		/// returns false if the key ends the search & should be handled as usual
+		bool historySearchKey(int key);
 		void keepCursorVisible();
+	
+		/// commit pending printed text to the text buffer
+		void printPending();
+	
+		/// remove the oldest lines down to 3/4 of the max lines & chars
+		/// when over either so lines aren't removed one at a time
+		void trimLines();
 
 		ofxReplListener *m_listener; //< eval event listener
 		
@@ -119,22 +188,40 @@ class ofxRepl : public ofxEditor {
 
 		std::u32string m_evalText; //< text to be evaluated when enter is pressed
 		
-		deque<std::u32string> m_history; //< line history
-		deque<std::u32string>::iterator m_historyIter; //< current position in line history
+		ofxReplHistory m_history; //< line history
+		size_t m_historyPos; //< current position in line history, size() for the live input
 		bool m_historyNavStarted; //< is the cursor within the line history?
 		std::u32string m_historyPresent; //< current history line (aka live input)
+	
+		bool m_searching; //< is a reverse history search running?
+		std::string m_searchText; //< UTF-8 search text
+		unsigned int m_searchUTF8Bytes; //< bytes left in a multibyte search char
+		size_t m_searchPos; //< current search match or npos
 		unsigned int m_linePos; //< current line the cursor is on
 	
+		std::u32string m_pendingText; //< printed text waiting to be committed
+		bool m_pendingBeforePrompt; //< is the pending text printed above the prompt?
+	
+		bool m_evalPending; //< is an eval waiting for its return?
+	
 		static std::u32string s_banner; //< REPL header/greeting, default: ""
 		static std::u32string s_prompt; //< prompt string, default: "> "
+		static unsigned int s_maxLines; //< max console lines, default: 256
+		static size_t s_maxChars; //< max console chars, default: 65536
 		
 	private:
 
-		/// custom logger to grab prints in the REPL
+		/// custom logger to grab prints in the REPL, messages from threads
+		/// other than the owner are queued for the owner to print
 		class Logger : public ofConsoleLoggerChannel {
 		public:
+			Logger(ofxRepl *parent);
 			ofxRepl *m_parent;
+			std::thread::id m_owner; //< thread which prints to the REPL
+			ofxEditorQueue<std::string> m_queue; //< messages from other threads
+			std::atomic<size_t> m_dropped; //< messages dropped when the queue was full
 			void log(ofLogLevel level, const std::string & module, const std::string & message);
+			void printQueued(); //< print queued messages, owner thread only
 		};
 		std::shared_ptr<Logger> m_logger;
 };
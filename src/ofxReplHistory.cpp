@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#include "ofxReplHistory.h"
+#include "Unicode.h"
+#include "ofLog.h"
+#include "ofFileUtils.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+// search text shorter than a trigram is matched by scanning
+#define TRIGRAM_LEN 3
+
+// temp file written when rewriting the history file
+#define TEMP_EXT ".tmp"
+
+/// pack the 3 chars at pos into an index key, code points are 21 bits
+static inline uint64_t history_trigram(const std::u32string &text, size_t pos) {
+	return ((uint64_t)(text[pos] & 0x1FFFFF) << 42) |
+	       ((uint64_t)(text[pos+1] & 0x1FFFFF) << 21) |
+	        (uint64_t)(text[pos+2] & 0x1FFFFF);
+}
+
+/// does an entry contain or start with text?
+static inline bool history_match(const std::u32string &entry, const std::u32string &text, bool prefix) {
+	if(prefix) {
+		return entry.compare(0, text.size(), text) == 0;
+	}
+	return entry.find(text) != std::u32string::npos;
+}
+
+/// append an entry to a history file line as UTF-8, line breaks &
+/// backslashes are escaped so each entry is a single line
+static inline void history_encode(std::string &line, const std::u32string &entry) {
+	std::string text;
+	wstring_append(text, entry);
+	for(size_t i = 0; i < text.size(); ++i) {
+		if(text[i] == '\n') {
+			line += "\\n";
+		}
+		else if(text[i] == '\\') {
+			line += "\\\\";
+		}
+		else {
+			line += text[i];
+		}
+	}
+	line += '\n';
+}
+
+/// decode a history file line without the line break
+static inline void history_decode(std::u32string &entry, const char *line, size_t size) {
+	std::string text;
+	text.reserve(size);
+	for(size_t i = 0; i < size; ++i) {
+		if(line[i] == '\\' && i+1 < size) {
+			++i;
+			text += (line[i] == 'n' ? '\n' : line[i]);
+		}
+		else {
+			text += line[i];
+		}
+	}
+	entry.clear();
+	string_append(entry, text);
+}
+
+/// replace a file with another, returns false on error
+static inline bool history_replace(const std::string &from, const std::string &to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+//--------------------------------------------------------------
+ofxReplHistory::ofxReplHistory() {
+	m_maxSize = 50000;
+	m_file = NULL;
+	m_loaded = true; // nothing to load
+}
+
+//--------------------------------------------------------------
+ofxReplHistory::~ofxReplHistory() {
+	if(m_file) {
+		fclose(m_file);
+	}
+}
+
+// ENTRIES
+
+//--------------------------------------------------------------
+void ofxReplHistory::add(const std::u32string &entry) {
+	load();
+	if(entry.empty() || (!m_entries.empty() && m_entries.back() == entry)) {
+		return;
+	}
+	m_entries.push_back(entry);
+	indexEntry(m_entries.size()-1);
+	if(m_file) {
+		std::string line;
+		history_encode(line, entry);
+		if(fwrite(line.data(), 1, line.size(), m_file) != line.size() || fflush(m_file) != 0) {
+			ofLogError("ofxReplHistory") << "couldn't write history file \""
+				<< ofFilePath::getFileName(m_path) << "\"";
+			fclose(m_file);
+			m_file = NULL;
+		}
+	}
+
+	// remove a quarter at a time so the index & file aren't rebuilt per entry
+	if(m_entries.size() > m_maxSize) {
+		evict(m_entries.size() - m_maxSize*3/4);
+		if(m_file) {
+			rewrite();
+		}
+	}
+}
+
+//--------------------------------------------------------------
+const std::u32string& ofxReplHistory::get(size_t index) {
+	load();
+	return m_entries[index];
+}
+
+//--------------------------------------------------------------
+size_t ofxReplHistory::size() {
+	load();
+	return m_entries.size();
+}
+
+//--------------------------------------------------------------
+bool ofxReplHistory::empty() {
+	load();
+	return m_entries.empty();
+}
+
+//--------------------------------------------------------------
+void ofxReplHistory::clear() {
+	m_entries.clear();
+	m_index.clear();
+	m_loaded = true;
+	if(!m_path.empty()) {
+		rewrite();
+	}
+}
+
+//--------------------------------------------------------------
+void ofxReplHistory::setMaxSize(size_t entries) {
+	m_maxSize = std::max(entries, (size_t)1);
+	if(m_loaded && m_entries.size() > m_maxSize) {
+		evict(m_entries.size() - m_maxSize);
+		if(m_file) {
+			rewrite();
+		}
+	}
+}
+
+//--------------------------------------------------------------
+size_t ofxReplHistory::getMaxSize() const {
+	return m_maxSize;
+}
+
+// SEARCH
+
+//--------------------------------------------------------------
+size_t ofxReplHistory::find(const std::u32string &text, size_t before) {
+	return search(text, before, false, true);
+}
+
+//--------------------------------------------------------------
+size_t ofxReplHistory::findNewer(const std::u32string &text, size_t after) {
+	return search(text, after, false, false);
+}
+
+//--------------------------------------------------------------
+size_t ofxReplHistory::findPrefix(const std::u32string &prefix, size_t before) {
+	return search(prefix, before, true, true);
+}
+
+//--------------------------------------------------------------
+size_t ofxReplHistory::findPrefixNewer(const std::u32string &prefix, size_t after) {
+	return search(prefix, after, true, false);
+}
+
+// HISTORY FILE
+
+//--------------------------------------------------------------
+void ofxReplHistory::setFile(const std::string &path) {
+	if(m_file) {
+		fclose(m_file);
+		m_file = NULL;
+	}
+	m_path = path;
+	m_entries.clear();
+	m_index.clear();
+	m_loaded = path.empty();
+}
+
+//--------------------------------------------------------------
+const std::string& ofxReplHistory::getFile() const {
+	return m_path;
+}
+
+// PROTECTED
+
+//--------------------------------------------------------------
+void ofxReplHistory::load() {
+	if(m_loaded) {
+		return;
+	}
+	m_loaded = true;
+
+	std::string data;
+	FILE *file = fopen(m_path.c_str(), "rb");
+	if(file) {
+		char buffer[4096];
+		size_t read;
+		while((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			data.append(buffer, read);
+		}
+		fclose(file);
+	}
+
+	// a last line without a line break was cut off by a crash, drop it
+	size_t lines = 0, pos = 0;
+	std::u32string entry;
+	while(pos < data.size()) {
+		size_t end = data.find('\n', pos);
+		if(end == std::string::npos) {
+			break;
+		}
+		lines++;
+		history_decode(entry, data.data() + pos, end - pos);
+		if(!entry.empty() && (m_entries.empty() || m_entries.back() != entry)) {
+			m_entries.push_back(entry);
+		}
+		pos = end+1;
+	}
+	if(m_entries.size() > m_maxSize) {
+		m_entries.erase(m_entries.begin(), m_entries.end() - m_maxSize);
+	}
+	for(size_t i = 0; i < m_entries.size(); ++i) {
+		indexEntry(i);
+	}
+
+	// rewrite when there's anything to drop, otherwise just append
+	if(pos < data.size() || lines > m_entries.size()) {
+		rewrite();
+	}
+	else {
+		m_file = fopen(m_path.c_str(), "ab");
+		if(!m_file) {
+			ofLogError("ofxReplHistory") << "couldn't open history file \""
+				<< ofFilePath::getFileName(m_path) << "\"";
+		}
+	}
+	ofLogVerbose("ofxReplHistory") << "loaded " << m_entries.size() << " entries from \""
+		<< ofFilePath::getFileName(m_path) << "\"";
+}
+
+//--------------------------------------------------------------
+bool ofxReplHistory::rewrite() {
+	if(m_file) {
+		fclose(m_file);
+		m_file = NULL;
+	}
+
+	// write next to the current file & swap them so a crash never leaves
+	// a partial history behind
+	std::string data;
+	for(size_t i = 0; i < m_entries.size(); ++i) {
+		history_encode(data, m_entries[i]);
+	}
+	std::string tmp = m_path + TEMP_EXT;
+	FILE *file = fopen(tmp.c_str(), "wb");
+	if(!file) {
+		ofLogError("ofxReplHistory") << "couldn't write history file \""
+			<< ofFilePath::getFileName(tmp) << "\"";
+		return false;
+	}
+	bool written = (fwrite(data.data(), 1, data.size(), file) == data.size() && fflush(file) == 0);
+	fclose(file);
+	if(!written || !history_replace(tmp, m_path)) {
+		ofLogError("ofxReplHistory") << "couldn't write history file \""
+			<< ofFilePath::getFileName(m_path) << "\"";
+		remove(tmp.c_str());
+		return false;
+	}
+	m_file = fopen(m_path.c_str(), "ab");
+	return m_file != NULL;
+}
+
+//--------------------------------------------------------------
+size_t ofxReplHistory::search(const std::u32string &text, size_t pos, bool prefix, bool older) {
+	load();
+	size_t size = m_entries.size();
+	if(older) {
+		pos = std::min(pos, size);
+	}
+	else if(pos == npos || pos+1 >= size) {
+		return npos;
+	}
+
+	// short text, scan from pos
+	if(text.size() < TRIGRAM_LEN) {
+		if(older) {
+			for(size_t i = pos; i > 0; --i) {
+				if(history_match(m_entries[i-1], text, prefix)) {
+					return i-1;
+				}
+			}
+		}
+		else {
+			for(size_t i = pos+1; i < size; ++i) {
+				if(history_match(m_entries[i], text, prefix)) {
+					return i;
+				}
+			}
+		}
+		return npos;
+	}
+
+	// every match contains all of the text's trigrams, so only check the
+	// entries with the rarest one
+	const std::vector<uint32_t> *rarest = NULL;
+	for(size_t i = 0; i + TRIGRAM_LEN <= text.size(); ++i) {
+		std::unordered_map<uint64_t, std::vector<uint32_t>>::const_iterator found =
+			m_index.find(history_trigram(text, i));
+		if(found == m_index.end()) {
+			return npos;
+		}
+		if(!rarest || found->second.size() < rarest->size()) {
+			rarest = &found->second;
+		}
+	}
+	if(older) {
+		std::vector<uint32_t>::const_iterator iter =
+			std::lower_bound(rarest->begin(), rarest->end(), (uint32_t)pos);
+		while(iter != rarest->begin()) {
+			--iter;
+			if(history_match(m_entries[*iter], text, prefix)) {
+				return *iter;
+			}
+		}
+	}
+	else {
+		std::vector<uint32_t>::const_iterator iter =
+			std::upper_bound(rarest->begin(), rarest->end(), (uint32_t)pos);
+		for(; iter != rarest->end(); ++iter) {
+			if(history_match(m_entries[*iter], text, prefix)) {
+				return *iter;
+			}
+		}
+	}
+	return npos;
+}
+
+//--------------------------------------------------------------
+void ofxReplHistory::indexEntry(size_t index) {
+	const std::u32string &entry = m_entries[index];
+	for(size_t i = 0; i + TRIGRAM_LEN <= entry.size(); ++i) {
+		std::vector<uint32_t> &entries = m_index[history_trigram(entry, i)];
+		if(entries.empty() || entries.back() != index) {
+			entries.push_back(index);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void ofxReplHistory::evict(size_t count) {
+	m_entries.erase(m_entries.begin(), m_entries.begin() + std::min(count, m_entries.size()));
+	m_index.clear();
+	for(size_t i = 0; i < m_entries.size(); ++i) {
+		indexEntry(i);
+	}
+}
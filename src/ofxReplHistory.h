@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * See https://github.com/Akira-Hayasaka/ofxGLEditor for more info.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+/// Repl command history with an optional append-only history file
+///
+/// entries are indexed by the trigrams (3 char sequences) they contain, a
+/// search only checks the entries holding the search text's rarest trigram
+/// so lookups stay fast with tens of thousands of entries, shorter search
+/// text is matched by scanning from the newest entry
+///
+/// the history file holds one entry per line & is only read on first use,
+/// each new entry is appended as it's added, the file is rewritten with the
+/// kept entries when it's grown past the max size
+class ofxReplHistory {
+
+	public:
+
+		ofxReplHistory();
+		virtual ~ofxReplHistory(); //< closes the history file
+
+		/// no entry
+		static const size_t npos = (size_t)-1;
+
+	/// \section Entries
+
+		/// add an entry as the newest, empty entries & repeats of the newest
+		/// entry are ignored, the oldest entries are removed in a batch when
+		/// over the max size
+		void add(const std::u32string &entry);
+
+		/// get an entry by index, 0 is the oldest
+		const std::u32string& get(size_t index);
+
+		/// number of entries
+		size_t size();
+
+		/// is the history empty?
+		bool empty();
+
+		/// remove all entries & clear the history file
+		void clear();
+
+		/// set the max number of entries kept, default: 50000
+		void setMaxSize(size_t entries);
+
+		/// get the max number of entries kept
+		size_t getMaxSize() const;
+
+	/// \section Search
+
+		/// find the newest entry older than before which contains text,
+		/// set before to size() or npos to search all entries,
+		/// returns the entry index or npos if not found
+		size_t find(const std::u32string &text, size_t before=npos);
+
+		/// find the oldest entry newer than after which contains text,
+		/// returns the entry index or npos if not found
+		size_t findNewer(const std::u32string &text, size_t after);
+
+		/// find the newest entry older than before which starts with prefix,
+		/// set before to size() or npos to search all entries,
+		/// returns the entry index or npos if not found
+		size_t findPrefix(const std::u32string &prefix, size_t before=npos);
+
+		/// find the oldest entry newer than after which starts with prefix,
+		/// returns the entry index or npos if not found
+		size_t findPrefixNewer(const std::u32string &prefix, size_t after);
+
+	/// \section History File
+
+		/// set the history file path, replaces the current entries with the
+		/// file's when first used, new entries are then appended to the file
+		/// set an empty path for a memory only history
+		void setFile(const std::string &path);
+
+		/// get the history file path
+		const std::string& getFile() const;
+
+	protected:
+
+		std::vector<std::u32string> m_entries; //< entries, oldest first
+		std::unordered_map<uint64_t, std::vector<uint32_t>> m_index; //< entry indices by trigram, ascending
+		size_t m_maxSize; //< max number of entries
+
+		std::string m_path; //< history file path
+		FILE *m_file;       //< history file open for appending or NULL
+		bool m_loaded;      //< has the history file been loaded?
+
+		/// load the history file if it hasn't been loaded yet
+		void load();
+
+		/// rewrite the history file with the current entries, returns false
+		/// on error
+		bool rewrite();
+
+		/// search for text in the entries before or after pos, see find()
+		size_t search(const std::u32string &text, size_t pos, bool prefix, bool older);
+
+		/// add an entry's trigrams to the index
+		void indexEntry(size_t index);
+
+		/// remove the oldest entries & rebuild the index
+		void evict(size_t count);
+};